@@ -7,6 +7,7 @@
 #include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/time.h>
+#include <sys/sendfile.h>
 #include <pthread.h>
 #include <errno.h>
 #include <stdint.h>
@@ -14,6 +15,19 @@
 #include <stdbool.h>
 #include <libgen.h>
 #include <math.h>
+#include <sched.h>
+#include <time.h>
+#include <stdatomic.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#include <linux/aio_abi.h>
+#include <linux/fs.h>
+#include <linux/fiemap.h>
+#include <sys/ioctl.h>
+#include <sys/sysmacros.h>
+#include <linux/mempolicy.h>
+#include <dirent.h>
+#include <limits.h>
 
 
 // Define copy mode enum
@@ -22,6 +36,10 @@ typedef enum {
     MMAP,
     DIRECT_IO,
     DIRECT_IO_MEMORY_IMPACT,
+    IO_URING,
+    LIBAIO,
+    COPY_FILE_RANGE,
+    SPLICE,
     GENERATE_TEST_FILES
 } CopyMode;
 
@@ -34,12 +52,127 @@ typedef struct {
     double size_mib;
     double duration;
     double speed;
+    const char *method;  // Kernel path actually used, NULL if not applicable
+    int result;
+    // Chunked copies (--chunks-per-file), num_chunks is 0 when copied whole
+    uint64_t file_size;
+    int num_chunks;
+    atomic_int chunks_started;
+    atomic_int chunks_left;
+    atomic_bool chunk_failed;
+    atomic_int splits;       // Pieces split off by idle workers (straggler mitigation)
+    struct timeval start;
+    // Autotune calibration window, sample_size 0 copies the whole file
+    uint64_t sample_offset;
+    uint64_t sample_size;
+    int numa_node;           // Node the file's workers and buffers are placed on, -1 if none
+    atomic_ulong cpus_used[CPU_SETSIZE / 64];  // CPUs the file's jobs ran on
 } CopyTask;
 
 // Constants definition
+#undef BLOCK_SIZE  // linux/fs.h (pulled in by linux/io_uring.h) has its own
 #define BLOCK_SIZE 512
 #define MAX_READ_SIZE (1024 * 1024 * 1024)  // 1GB
 #define MMAP_CHUNK_SIZE (512 * 1024 * 1024) // 512MB 
+#define DMA_BLOCK_SIZE (2 * 1024 * 1024)     // 2MB
+#define DEFAULT_IO_BLOCK_SIZE (1024 * 1024)  // 1MB per request
+#define DEFAULT_QUEUE_DEPTH 32
+#define DEFAULT_PIPE_SIZE (1024 * 1024)  // 1MB, the default pipe-max-size
+#define DEFAULT_DIRECT_IO_BUFFERS 4
+#define DEFAULT_CHUNKS_PER_FILE 1
+#define DEFAULT_MIN_SPLIT (64 * 1024 * 1024)  // 64MB
+#define KERNEL_COPY_CLAIM_SIZE (64 * 1024 * 1024)  // copy_file_range bytes per claim
+#define DEFAULT_AUTOTUNE_SAMPLE (64 * 1024 * 1024)  // 64MB copied per calibration trial
+#define DEFAULT_MAX_INFLIGHT (1024ULL * 1024 * 1024)  // 1GB cap for --adaptive
+
+// Order in which files (or chunks) are handed to the worker pool
+typedef enum {
+    SCHEDULE_FIFO,    // Command line order
+    SCHEDULE_LPT,     // Longest processing time first, minimises makespan
+    SCHEDULE_EXTENT   // Physical extent order on the source device, minimises seeks
+} SchedulePolicy;
+
+// Where copy workers and their buffers are placed (--numa)
+typedef enum {
+    NUMA_NONE,  // Wherever the scheduler puts them
+    NUMA_SRC,   // Node of the source file's device
+    NUMA_DST,   // Node of the destination directory's device
+    NUMA_NODE   // A fixed node given on the command line
+} NumaPolicy;
+
+// Order in which pool workers are bound to CPUs (--pin)
+typedef enum {
+    PIN_NONE,     // Workers float over --cpus (or every CPU)
+    PIN_COMPACT,  // Fill one socket and core at a time, SMT siblings adjacent
+    PIN_CORES,    // Spread over physical cores, SMT siblings last
+    PIN_SOCKETS   // Alternate between sockets
+} PinPolicy;
+
+// Page size backing the copy buffers (--huge-pages)
+typedef enum {
+    HUGE_PAGES_NONE,  // Regular 4KB pages from posix_memalign
+    HUGE_PAGES_THP,   // Transparent huge pages requested with MADV_HUGEPAGE
+    HUGE_PAGES_2M,    // Reserved hugetlb pages, falling back to THP
+    HUGE_PAGES_1G
+} HugePagePolicy;
+
+// memcpy used by the CPU-side copies (--copy-kernel)
+typedef enum {
+    COPY_KERNEL_AUTO,       // Widest non-temporal kernel the CPU supports
+    COPY_KERNEL_LIBC,       // memcpy
+    COPY_KERNEL_PREFETCH,   // Cache-line loop with software prefetch
+    COPY_KERNEL_REP_MOVSB,  // x86 string copy (ERMS)
+    COPY_KERNEL_AVX2_NT,    // 32-byte streaming stores
+    COPY_KERNEL_AVX512_NT,  // 64-byte streaming stores
+    NUM_COPY_KERNELS
+} CopyKernel;
+
+// Tuning options for the copy engines, set from the command line.
+// The defines above are the defaults.
+typedef struct {
+    size_t align;        // O_DIRECT buffer/offset alignment (BLOCK_SIZE)
+    size_t read_size;    // Per-file read budget for direct_io and memory impact (MAX_READ_SIZE)
+    size_t mmap_chunk_size;  // Bytes mapped at a time by mmap mode (MMAP_CHUNK_SIZE)
+    size_t dma_block_size;   // memcpy size per simulated DMA transfer (DMA_BLOCK_SIZE)
+    size_t block_size;   // Bytes per read/write request
+    int queue_depth;     // Requests kept in flight per file
+    size_t pipe_size;    // Pipe buffer size for splice mode
+    int direct_io_buffers;  // Ring slots between the direct_io reader and writer
+    int chunks_per_file;    // Offset ranges each file is split into
+    int threads;            // Worker pool size, 0 means one per CPU
+    SchedulePolicy schedule;
+    size_t min_split;       // Smallest piece idle workers split off a straggler, 0 disables
+    bool autotune;          // Calibrate threads/block size/queue depth before copying
+    size_t autotune_sample; // Bytes copied per calibration trial, spread over the files
+    bool adaptive;          // AIMD in-flight byte budget shared by the whole pool
+    uint64_t max_inflight;  // Upper bound for the adaptive budget
+    NumaPolicy numa;
+    int numa_node;          // Node for NUMA_NODE
+    bool has_cpus;          // Workers are restricted to cpus (--cpus)
+    cpu_set_t cpus;
+    PinPolicy pin;
+    HugePagePolicy huge_pages;
+    uint64_t buffer_budget; // Bytes the shared buffer pool may own, 0 means unlimited
+    CopyKernel copy_kernel;
+    double progress_interval;  // Seconds between live progress lines, 0 disables
+    const char *progress_log;  // CSV file the progress samples are also written to
+} CopyOptions;
+
+static CopyOptions g_options = {
+    .align = BLOCK_SIZE,
+    .read_size = MAX_READ_SIZE,
+    .mmap_chunk_size = MMAP_CHUNK_SIZE,
+    .dma_block_size = DMA_BLOCK_SIZE,
+    .block_size = DEFAULT_IO_BLOCK_SIZE,
+    .queue_depth = DEFAULT_QUEUE_DEPTH,
+    .pipe_size = DEFAULT_PIPE_SIZE,
+    .direct_io_buffers = DEFAULT_DIRECT_IO_BUFFERS,
+    .chunks_per_file = DEFAULT_CHUNKS_PER_FILE,
+    .schedule = SCHEDULE_FIFO,
+    .min_split = DEFAULT_MIN_SPLIT,
+    .autotune_sample = DEFAULT_AUTOTUNE_SAMPLE,
+    .max_inflight = DEFAULT_MAX_INFLIGHT,
+};
 
 
 // random number generator structure and functions
@@ -69,597 +202,5308 @@ static void fill_buffer_with_random_data(RandomGenerator *gen, void *buffer, siz
 }
 
 
-// Simplified system cp command copy function
-static int copy_using_cp(const char *src, const char *dst) {
-    char command[1024];
-    snprintf(command, sizeof(command), "cp %s %s", src, dst);
-    return system(command);
+static inline size_t align_up(size_t value, size_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
 }
 
-// Simplified mmap copy function
-static int copy_using_mmap(const char *src, const char *dst, size_t file_size) {
-    int src_fd = open(src, O_RDONLY);
-    int dst_fd = open(dst, O_RDWR | O_CREAT, 0644);
-    if (src_fd < 0 || dst_fd < 0) {
-        return -1;
+// Byte range of a file being copied. Engines claim blocks from the front while idle
+// workers may split off the unclaimed back half (straggler mitigation), so every
+// access goes through the lock.
+typedef struct {
+    pthread_mutex_t lock;
+    uint64_t next;  // First byte not yet claimed
+    uint64_t end;
+} CopyRange;
+
+static void range_init(CopyRange *range, uint64_t offset, uint64_t end) {
+    pthread_mutex_init(&range->lock, NULL);
+    range->next = offset;
+    range->end = end;
+}
+
+static void range_destroy(CopyRange *range) {
+    pthread_mutex_destroy(&range->lock);
+}
+
+// Claim up to max_length bytes from the front, false once the range is exhausted
+static bool range_claim(CopyRange *range, size_t max_length, uint64_t *offset, size_t *length) {
+    pthread_mutex_lock(&range->lock);
+    bool claimed = range->next < range->end;
+    if (claimed) {
+        uint64_t remaining = range->end - range->next;
+        *offset = range->next;
+        *length = (remaining < max_length) ? remaining : max_length;
+        range->next += *length;
     }
+    pthread_mutex_unlock(&range->lock);
+    return claimed;
+}
 
-    if (ftruncate(dst_fd, file_size) != 0) {
-        close(src_fd);
-        close(dst_fd);
-        return -1;
+static uint64_t range_remaining(CopyRange *range) {
+    pthread_mutex_lock(&range->lock);
+    uint64_t remaining = range->end - range->next;
+    pthread_mutex_unlock(&range->lock);
+    return remaining;
+}
+
+// Stop handing out blocks after a failure so nobody splits a broken range
+static void range_abandon(CopyRange *range) {
+    pthread_mutex_lock(&range->lock);
+    range->end = range->next;
+    pthread_mutex_unlock(&range->lock);
+}
+
+// Adaptive concurrency (--adaptive): every engine takes in-flight bytes from one
+// pool-wide budget before issuing a block and returns them when the block is written.
+// A controller thread resizes the budget AIMD style: it doubles while the budget is the
+// bottleneck (slow start), then grows by one request per window, and halves whenever
+// per-byte latency inflates past ADAPTIVE_LATENCY_INFLATION times the best seen.
+#define ADAPTIVE_WINDOW_MS 100
+#define ADAPTIVE_LATENCY_INFLATION 2.0
+#define ADAPTIVE_BASELINE_DECAY 1.01  // Let the latency baseline forget a fast start slowly
+
+typedef struct {
+    bool enabled;
+    pthread_mutex_t lock;
+    pthread_cond_t released;
+    uint64_t limit;
+    uint64_t max_limit;
+    uint64_t in_flight;
+    uint64_t step;           // Largest request seen, the additive increase
+    bool slow_start;
+    bool saturated;          // A request had to wait during this window
+    // Completions in the current window
+    uint64_t window_bytes;
+    uint64_t window_latency_ns;
+    double baseline_ns_per_mib;
+    // Reported after the copy
+    uint64_t peak_limit;
+    int backoffs;
+    bool stop;
+    pthread_t controller;
+} InflightLimiter;
+
+static InflightLimiter g_limiter = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .released = PTHREAD_COND_INITIALIZER,
+};
+
+static uint64_t monotonic_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// Per-I/O latency histograms, log-linear like HdrHistogram: values below
+// 2 * LATENCY_SUB_BUCKETS ns are exact, above that every power of two is split into
+// LATENCY_SUB_BUCKETS buckets, so a value is known to within about 3%.
+// Each thread records into its own histogram without locking; they are merged when
+// the results are printed.
+#define LATENCY_SUB_BUCKET_BITS 5
+#define LATENCY_SUB_BUCKETS (1 << LATENCY_SUB_BUCKET_BITS)
+#define LATENCY_MAX_BITS 40  // 2^40 ns, about 18 minutes, longer calls land in the last bucket
+#define LATENCY_BUCKETS ((LATENCY_MAX_BITS - LATENCY_SUB_BUCKET_BITS + 1) * LATENCY_SUB_BUCKETS)
+
+typedef enum {
+    LATENCY_READ,   // pread, io_uring/libaio reads, splice into the pipe
+    LATENCY_WRITE,  // pwrite, io_uring/libaio writes, splice out of the pipe
+    LATENCY_COPY,   // copy_file_range/sendfile, read and write in one call
+    LATENCY_SYNC,   // msync
+    NUM_LATENCY_OPS
+} LatencyOp;
+
+static const char *latency_op_names[NUM_LATENCY_OPS] = {"read", "write", "copy", "msync"};
+
+typedef struct LatencyHistogram {
+    uint64_t counts[NUM_LATENCY_OPS][LATENCY_BUCKETS];
+    uint64_t total[NUM_LATENCY_OPS];
+    uint64_t max[NUM_LATENCY_OPS];
+    struct LatencyHistogram *next;
+} LatencyHistogram;
+
+// Every thread's histogram; latency_reset() frees them all and bumps the generation,
+// so threads still holding an old one allocate a fresh one on their next record
+static struct {
+    pthread_mutex_t lock;
+    LatencyHistogram *histograms;
+    atomic_int generation;
+} g_latency = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+};
+
+static __thread LatencyHistogram *t_latency;
+static __thread int t_latency_generation;
+
+static int latency_bucket(uint64_t ns) {
+    if (ns < 2 * LATENCY_SUB_BUCKETS) {
+        return (int)ns;
     }
+    int exponent = 63 - __builtin_clzll(ns) - LATENCY_SUB_BUCKET_BITS;
+    int bucket = exponent * LATENCY_SUB_BUCKETS + (int)(ns >> exponent);
+    return (bucket < LATENCY_BUCKETS) ? bucket : LATENCY_BUCKETS - 1;
+}
 
-    size_t remaining = file_size;
-    size_t offset = 0;
+// Highest value that falls into the bucket
+static uint64_t latency_bucket_value(int bucket) {
+    if (bucket < 2 * LATENCY_SUB_BUCKETS) {
+        return bucket;
+    }
+    int exponent = bucket / LATENCY_SUB_BUCKETS - 1;
+    uint64_t sub = bucket % LATENCY_SUB_BUCKETS + LATENCY_SUB_BUCKETS;
+    return ((sub + 1) << exponent) - 1;
+}
 
-    while (remaining > 0) {
-        size_t chunk_size = (remaining < MMAP_CHUNK_SIZE) ? remaining : MMAP_CHUNK_SIZE;
-        
-        void *src_map = mmap(NULL, chunk_size, PROT_READ, MAP_PRIVATE, src_fd, offset);
-        void *dst_map = mmap(NULL, chunk_size, PROT_WRITE, MAP_SHARED, dst_fd, offset);
-        
-        if (src_map == MAP_FAILED || dst_map == MAP_FAILED) {
-            close(src_fd);
-            close(dst_fd);
-            return -1;
+// Record one call that started at start_ns
+static void latency_record(LatencyOp op, uint64_t start_ns) {
+    uint64_t ns = monotonic_ns() - start_ns;
+    int generation = atomic_load_explicit(&g_latency.generation, memory_order_relaxed);
+
+    if (!t_latency || t_latency_generation != generation) {
+        t_latency = calloc(1, sizeof(LatencyHistogram));
+        if (!t_latency) {
+            return;
         }
+        t_latency_generation = generation;
+        pthread_mutex_lock(&g_latency.lock);
+        t_latency->next = g_latency.histograms;
+        g_latency.histograms = t_latency;
+        pthread_mutex_unlock(&g_latency.lock);
+    }
 
-        memcpy(dst_map, src_map, chunk_size);
-        msync(dst_map, chunk_size, MS_SYNC);
-        
-        munmap(src_map, chunk_size);
-        munmap(dst_map, chunk_size);
-        
-        remaining -= chunk_size;
-        offset += chunk_size;
+    t_latency->counts[op][latency_bucket(ns)]++;
+    t_latency->total[op]++;
+    if (ns > t_latency->max[op]) {
+        t_latency->max[op] = ns;
     }
+}
 
-    close(src_fd);
-    close(dst_fd);
-    return 0;
+// Drop everything recorded so far, only while no I/O is running
+static void latency_reset(void) {
+    pthread_mutex_lock(&g_latency.lock);
+    while (g_latency.histograms) {
+        LatencyHistogram *histogram = g_latency.histograms;
+        g_latency.histograms = histogram->next;
+        free(histogram);
+    }
+    atomic_fetch_add(&g_latency.generation, 1);
+    pthread_mutex_unlock(&g_latency.lock);
 }
 
-// Simplified direct I/O copy function
-static int copy_using_direct_io(const char *src, const char *dst, size_t file_size) {
-    int src_fd = open(src, O_RDONLY | O_DIRECT);
-    int dst_fd = open(dst, O_WRONLY | O_CREAT | O_DIRECT, 0644);
-    
-    if (src_fd < 0 || dst_fd < 0) {
-        return -1;
+// Sum every thread's histogram into merged
+static void latency_merge(LatencyHistogram *merged) {
+    memset(merged, 0, sizeof(*merged));
+    pthread_mutex_lock(&g_latency.lock);
+    for (LatencyHistogram *histogram = g_latency.histograms; histogram; histogram = histogram->next) {
+        for (int op = 0; op < NUM_LATENCY_OPS; op++) {
+            for (int b = 0; b < LATENCY_BUCKETS; b++) {
+                merged->counts[op][b] += histogram->counts[op][b];
+            }
+            merged->total[op] += histogram->total[op];
+            if (histogram->max[op] > merged->max[op]) {
+                merged->max[op] = histogram->max[op];
+            }
+        }
     }
+    pthread_mutex_unlock(&g_latency.lock);
+}
 
-    // Allocate aligned buffer
-    void *buffer = NULL;
-    if (posix_memalign(&buffer, BLOCK_SIZE, MAX_READ_SIZE) != 0) {
-        close(src_fd);
-        close(dst_fd);
-        return -1;
+// Value at or below which the given share of the calls fell
+static uint64_t latency_percentile(const LatencyHistogram *histogram, LatencyOp op, double percentile) {
+    uint64_t rank = (uint64_t)ceil(histogram->total[op] * percentile / 100.0);
+    uint64_t seen = 0;
+    for (int b = 0; b < LATENCY_BUCKETS; b++) {
+        seen += histogram->counts[op][b];
+        if (seen >= rank && seen > 0) {
+            uint64_t value = latency_bucket_value(b);
+            return (value < histogram->max[op]) ? value : histogram->max[op];
+        }
     }
+    return histogram->max[op];
+}
 
-    size_t remaining = file_size;
-    while (remaining > 0) {
-        size_t to_read = (remaining < MAX_READ_SIZE) ? remaining : MAX_READ_SIZE;
-        to_read = (to_read / BLOCK_SIZE) * BLOCK_SIZE;  // Align to block size
-        
-        ssize_t bytes_read = read(src_fd, buffer, to_read);
-        if (bytes_read <= 0) break;
-        
-        ssize_t bytes_written = write(dst_fd, buffer, bytes_read);
-        if (bytes_written != bytes_read) break;
-        
-        remaining -= bytes_read;
+// Live progress (--progress): workers add completed bytes to their own counter, a
+// sampler thread sums them every interval and prints the throughput of that interval,
+// so throttling and cache-exhaustion cliffs show up as a time series
+#define PROGRESS_MAX_WORKERS 1024  // Workers past this share counters
+#define PROGRESS_SLEEP_SLICE_MS 50 // Sampler checks for stop this often
+
+typedef struct {
+    atomic_uint_fast64_t bytes;
+    char pad[64 - sizeof(atomic_uint_fast64_t)];  // One cache line per worker
+} ProgressCounter;
+
+static ProgressCounter g_progress_counters[PROGRESS_MAX_WORKERS];
+static __thread atomic_uint_fast64_t *t_progress;  // Set for copy pool workers only
+
+static void progress_add(uint64_t bytes) {
+    if (t_progress) {
+        atomic_fetch_add_explicit(t_progress, bytes, memory_order_relaxed);
     }
+}
 
-    free(buffer);
-    close(src_fd);
-    close(dst_fd);
-    return (remaining == 0) ? 0 : -1;
+static uint64_t progress_bytes(void) {
+    uint64_t total = 0;
+    for (int i = 0; i < PROGRESS_MAX_WORKERS; i++) {
+        total += atomic_load_explicit(&g_progress_counters[i].bytes, memory_order_relaxed);
+    }
+    return total;
 }
 
-// Add new copy function
-static int copy_using_direct_io_memory_impact(const char *src, const char *dst, size_t file_size) {
-    // Use system page size as base alignment unit
-    const size_t page_size = sysconf(_SC_PAGESIZE);
-    // Use 2MB as DMA transfer block size
-    const size_t dma_block_size = 2 * 1024 * 1024;  // 2MB
-    
-    void *src_buffer = NULL;
-    void *dst_buffer = NULL;
-    
-    // Ensure buffers are page-aligned
-    if (posix_memalign(&src_buffer, page_size, MAX_READ_SIZE) != 0 ||
-        posix_memalign(&dst_buffer, page_size, MAX_READ_SIZE) != 0) {
-        free(src_buffer);
-        free(dst_buffer);
-        return -1;
+typedef struct {
+    bool enabled;          // Set by handle_copy_files() so autotune trials are not sampled
+    pthread_t thread;
+    atomic_bool stop;
+    uint64_t total_bytes;  // Bytes the copy will move, for the percentage and ETA
+    uint64_t start_ns;
+    uint64_t last_ns;
+    uint64_t last_bytes;
+    FILE *log;             // --progress-log CSV, NULL if not logging
+} ProgressSampler;
+
+static ProgressSampler g_progress;
+
+// Print one sample and append it to the log
+static void progress_sample(void) {
+    uint64_t now = monotonic_ns();
+    uint64_t done = progress_bytes();
+    double elapsed = (now - g_progress.start_ns) / 1e9;
+    double interval = (now - g_progress.last_ns) / 1e9;
+    double speed = interval > 0 ? (done - g_progress.last_bytes) / (1024.0 * 1024.0) / interval : 0;
+    double average = elapsed > 0 ? done / (1024.0 * 1024.0) / elapsed : 0;
+    uint64_t left = (done < g_progress.total_bytes) ? g_progress.total_bytes - done : 0;
+    double percent = g_progress.total_bytes ? fmin(100.0, 100.0 * done / g_progress.total_bytes) : 100.0;
+
+    // No ETA until something has completed, a zero would read as finished
+    char eta[32] = "-";
+    char eta_csv[32] = "";
+    if (average > 0) {
+        double seconds = left / (1024.0 * 1024.0) / average;
+        snprintf(eta, sizeof(eta), "%dm%02ds", (int)seconds / 60, (int)seconds % 60);
+        snprintf(eta_csv, sizeof(eta_csv), "%.1f", seconds);
     }
 
-    // Replace original random data generation code
-    RandomGenerator gen;
-    init_random_generator(&gen);
-    fill_buffer_with_random_data(&gen, src_buffer, MAX_READ_SIZE);
+    printf("[%8.1fs] %10.2f MiB/s (avg %.2f)  %.2f / %.2f GiB  %5.1f%%  ETA %s\n",
+           elapsed, speed, average, done / (1024.0 * 1024.0 * 1024.0),
+           g_progress.total_bytes / (1024.0 * 1024.0 * 1024.0), percent, eta);
+    fflush(stdout);
+    if (g_progress.log) {
+        fprintf(g_progress.log, "%.3f,%llu,%.2f,%.2f,%s\n", elapsed, (unsigned long long)done, speed, average, eta_csv);
+        fflush(g_progress.log);
+    }
 
-    // Force memory barrier to ensure initialization is complete
-    __sync_synchronize();
+    g_progress.last_ns = now;
+    g_progress.last_bytes = done;
+}
 
-    // Simulate DMA transfer process
-    size_t remaining = file_size;
-    char *current_src = (char *)src_buffer;
-    char *current_dst = (char *)dst_buffer;
-    volatile uint64_t checksum = 0;
+static void *progress_sampler_thread(void *arg) {
+    (void)arg;
+    uint64_t interval_ns = (uint64_t)(g_options.progress_interval * 1e9);
+    uint64_t next = g_progress.start_ns + interval_ns;
+    struct timespec slice = {0, PROGRESS_SLEEP_SLICE_MS * 1000000L};
 
-    while (remaining > 0) {
-        size_t current_chunk = (remaining < MAX_READ_SIZE) ? remaining : MAX_READ_SIZE;
-        size_t chunk_remaining = current_chunk;
-        
-        char *chunk_src = current_src;
-        char *chunk_dst = current_dst;
-        
-        // Transfer by DMA block size
-        while (chunk_remaining >= dma_block_size) {
-            chunk_dst = (char *)memcpy(chunk_dst, chunk_src, dma_block_size) + dma_block_size;
-            chunk_src += dma_block_size;
-            chunk_remaining -= dma_block_size;
-            
-            // Verify after each DMA block transfer
-            for (size_t i = 0; i < dma_block_size; i += page_size) {
-                checksum ^= *(volatile uint64_t *)(chunk_dst - dma_block_size + i);
-            }
+    while (!atomic_load(&g_progress.stop)) {
+        nanosleep(&slice, NULL);
+        if (monotonic_ns() >= next) {
+            progress_sample();
+            next += interval_ns;
         }
-        
-        // Handle remaining bytes
-        if (chunk_remaining > 0) {
-            // Ensure remaining portion is also page-aligned
-            size_t aligned_remaining = (chunk_remaining + page_size - 1) & ~(page_size - 1);
-            chunk_dst = (char *)memcpy(chunk_dst, chunk_src, aligned_remaining) + aligned_remaining;
-            
-            // Verify remaining portion
-            for (size_t i = 0; i < aligned_remaining; i += page_size) {
-                checksum ^= *(volatile uint64_t *)(chunk_dst - aligned_remaining + i);
-            }
+    }
+    return NULL;
+}
+
+static void progress_start(void) {
+    for (int i = 0; i < PROGRESS_MAX_WORKERS; i++) {
+        atomic_store(&g_progress_counters[i].bytes, 0);
+    }
+    g_progress.start_ns = g_progress.last_ns = monotonic_ns();
+    g_progress.last_bytes = 0;
+    atomic_init(&g_progress.stop, false);
+    pthread_create(&g_progress.thread, NULL, progress_sampler_thread, NULL);
+}
+
+// Stop the sampler, bytes finished since the last sample are printed as a final one
+static void progress_stop(void) {
+    atomic_store(&g_progress.stop, true);
+    pthread_join(g_progress.thread, NULL);
+    if (progress_bytes() != g_progress.last_bytes) {
+        progress_sample();
+    }
+}
+
+// Take bytes of in-flight budget. A request is always admitted when nothing else is in
+// flight, so requests larger than the budget still make progress. Without may_block it
+// only tries, async engines use that while they still have requests of their own in flight.
+static bool inflight_acquire(uint64_t bytes, bool may_block) {
+    if (!g_limiter.enabled) {
+        return true;
+    }
+
+    pthread_mutex_lock(&g_limiter.lock);
+    if (bytes > g_limiter.step) {
+        g_limiter.step = bytes;
+    }
+    while (g_limiter.in_flight > 0 && g_limiter.in_flight + bytes > g_limiter.limit) {
+        g_limiter.saturated = true;
+        if (!may_block) {
+            pthread_mutex_unlock(&g_limiter.lock);
+            return false;
         }
-        
-        remaining -= current_chunk;
+        pthread_cond_wait(&g_limiter.released, &g_limiter.lock);
     }
+    g_limiter.in_flight += bytes;
+    pthread_mutex_unlock(&g_limiter.lock);
+    return true;
+}
 
-    free(src_buffer);
-    free(dst_buffer);
-    
-    return (checksum != 0) ? 0 : -1;
+// Return budget taken by inflight_acquire. completed is the number of bytes actually
+// copied (0 if the request was abandoned), issued_ns when the request started.
+static void inflight_release(uint64_t bytes, uint64_t completed, uint64_t issued_ns) {
+    if (!g_limiter.enabled) {
+        return;
+    }
+
+    uint64_t now = monotonic_ns();
+    pthread_mutex_lock(&g_limiter.lock);
+    g_limiter.in_flight -= bytes;
+    if (completed > 0) {
+        g_limiter.window_bytes += completed;
+        g_limiter.window_latency_ns += now - issued_ns;
+    }
+    pthread_cond_broadcast(&g_limiter.released);
+    pthread_mutex_unlock(&g_limiter.lock);
 }
 
-// Thread copy function
-void* copy_file_thread(void *arg) {
-    CopyTask *task = (CopyTask *)arg;
-    struct timeval start, end;
-    gettimeofday(&start, NULL);
+static void *inflight_controller_thread(void *arg) {
+    (void)arg;
+    const struct timespec window = {0, ADAPTIVE_WINDOW_MS * 1000000L};
 
-    struct stat st;
-    stat(task->src_path, &st);
-    task->size_mib = st.st_size / (1024.0 * 1024.0);
+    for (;;) {
+        nanosleep(&window, NULL);
 
-    int result = -1;
-    switch (task->mode) {
-        case SYSTEM_CP:
-            result = copy_using_cp(task->src_path, task->dst_path);
-            break;
-        case MMAP:
-            result = copy_using_mmap(task->src_path, task->dst_path, st.st_size);
-            break;
-        case DIRECT_IO:
-            result = copy_using_direct_io(task->src_path, task->dst_path, st.st_size);
-            break;
-        case DIRECT_IO_MEMORY_IMPACT:
-            result = copy_using_direct_io_memory_impact(task->src_path, task->dst_path, st.st_size);
+        pthread_mutex_lock(&g_limiter.lock);
+        if (g_limiter.stop) {
+            pthread_mutex_unlock(&g_limiter.lock);
             break;
-    }
+        }
 
-    gettimeofday(&end, NULL);
-    task->duration = (end.tv_sec - start.tv_sec) + 
-                    (end.tv_usec - start.tv_usec) / 1000000.0;
-    task->speed = task->size_mib / task->duration;
+        if (g_limiter.window_bytes > 0) {
+            // Normalise by size so engines with different request sizes compare
+            double ns_per_mib = (double)g_limiter.window_latency_ns * (1024.0 * 1024.0) /
+                                g_limiter.window_bytes;
+            double baseline = g_limiter.baseline_ns_per_mib * ADAPTIVE_BASELINE_DECAY;
+            if (baseline == 0 || ns_per_mib < baseline) {
+                baseline = ns_per_mib;
+            }
+            g_limiter.baseline_ns_per_mib = baseline;
+
+            if (ns_per_mib > baseline * ADAPTIVE_LATENCY_INFLATION) {
+                // Multiplicative decrease: the device is queueing, not going faster
+                g_limiter.limit /= 2;
+                if (g_limiter.limit < g_limiter.step) {
+                    g_limiter.limit = g_limiter.step;
+                }
+                g_limiter.slow_start = false;
+                g_limiter.backoffs++;
+            } else if (g_limiter.saturated) {
+                // Additive increase of one request, doubling during slow start
+                uint64_t increase = g_limiter.step;
+                if (g_limiter.slow_start && g_limiter.limit > increase) {
+                    increase = g_limiter.limit;
+                }
+                g_limiter.limit += increase;
+                if (g_limiter.limit > g_limiter.max_limit) {
+                    g_limiter.limit = g_limiter.max_limit;
+                }
+            }
+            if (g_limiter.limit > g_limiter.peak_limit) {
+                g_limiter.peak_limit = g_limiter.limit;
+            }
+            pthread_cond_broadcast(&g_limiter.released);
+        }
 
+        g_limiter.window_bytes = 0;
+        g_limiter.window_latency_ns = 0;
+        g_limiter.saturated = false;
+        pthread_mutex_unlock(&g_limiter.lock);
+    }
     return NULL;
 }
 
-// Parse file size string
-static uint64_t parse_size(const char *size_str) {
-    uint64_t size;
-    char unit;
-    if (sscanf(size_str, "%lu%c", &size, &unit) != 2) {
-        return 0;
+// Reset the budget to one request and start the controller for one copy run
+static void inflight_limiter_start(uint64_t initial) {
+    g_limiter.limit = initial;
+    g_limiter.step = initial;
+    g_limiter.peak_limit = initial;
+    g_limiter.in_flight = 0;
+    g_limiter.slow_start = true;
+    g_limiter.saturated = false;
+    g_limiter.window_bytes = 0;
+    g_limiter.window_latency_ns = 0;
+    g_limiter.baseline_ns_per_mib = 0;
+    g_limiter.backoffs = 0;
+    g_limiter.stop = false;
+    pthread_create(&g_limiter.controller, NULL, inflight_controller_thread, NULL);
+}
+
+static void inflight_limiter_stop(void) {
+    pthread_mutex_lock(&g_limiter.lock);
+    g_limiter.stop = true;
+    pthread_mutex_unlock(&g_limiter.lock);
+    pthread_join(g_limiter.controller, NULL);
+}
+
+// NUMA placement (--numa): workers run on the CPUs of the node the job's NVMe
+// controller hangs off, and copy buffers get that node's memory. Nodes come from sysfs
+// so no libnuma is needed.
+#define NUMA_MAX_NODES 1024
+
+static __thread int t_numa_node = -1;  // Node the current worker is placed on, -1 if none
+
+// Replace dir with the sysfs path of its first slaves/ member, false if it has none
+static bool sysfs_first_slave(char *dir) {
+    char path[PATH_MAX + 16];
+    snprintf(path, sizeof(path), "%s/slaves", dir);
+    DIR *dp = opendir(path);
+    if (!dp) {
+        return false;
     }
-    
-    switch (toupper(unit)) {
-        case 'T':
-            size *= 1024;
-        case 'G':
-            size *= 1024;
-        case 'M':
-            size *= 1024 * 1024;
+
+    bool found = false;
+    struct dirent *entry;
+    while ((entry = readdir(dp))) {
+        if (entry->d_name[0] != '.') {
+            snprintf(path, sizeof(path), "/sys/class/block/%s", entry->d_name);
+            found = realpath(path, dir) != NULL;
             break;
-        default:
-            return 0;
+        }
     }
-    
-    return size;
+    closedir(dp);
+    return found;
 }
 
-// Generate test file
-static int generate_test_file(const char *path, uint64_t size) {
-    int fd;
-    void *buf = NULL;
-    const size_t buf_size = 1024 * 1024; // 1MB buffer
-    uint64_t remaining = size;
-    
-    // Use O_DIRECT for better performance
-    fd = open(path, O_WRONLY | O_CREAT | O_DIRECT, 0644);
-    if (fd < 0) {
-        // If O_DIRECT fails, try without it
-        fd = open(path, O_WRONLY | O_CREAT, 0644);
-        if (fd < 0) {
-            perror("open");
-            return -1;
-        }
+// NUMA node of the device holding path: walk from /sys/dev/block/<major>:<minor> up to
+// the first ancestor with a numa_node (the PCI function of an NVMe namespace or
+// partition), following slaves/ for md and dm devices. -1 if unknown.
+static int numa_node_of_path(const char *path) {
+    struct stat st;
+    if (stat(path, &st) != 0) {
+        return -1;
     }
-    
-    // Allocate aligned memory
-    if (posix_memalign(&buf, 512, buf_size)) {
-        close(fd);
+
+    char link[PATH_MAX];
+    snprintf(link, sizeof(link), "/sys/dev/block/%u:%u", major(st.st_dev), minor(st.st_dev));
+    char dir[PATH_MAX];
+    if (!realpath(link, dir)) {
         return -1;
     }
-    
-    // Replace original random data generation code
-    RandomGenerator gen;
-    init_random_generator(&gen);
-    fill_buffer_with_random_data(&gen, buf, buf_size);
-    
-    // Write to file
+
+    // Stacked devices (RAID, LVM) have no PCI parent, follow their first member
+    for (int depth = 0; depth < 4 && sysfs_first_slave(dir); depth++) {
+    }
+
+    // Walk up to the PCI function, the first ancestor with a numa_node
+    while (strlen(dir) > strlen("/sys/devices")) {
+        char file[PATH_MAX + 16];
+        snprintf(file, sizeof(file), "%s/numa_node", dir);
+        FILE *fp = fopen(file, "r");
+        if (fp) {
+            int node = -1;
+            int found = fscanf(fp, "%d", &node);
+            fclose(fp);
+            // Firmware without locality information reports -1
+            return (found == 1) ? node : -1;
+        }
+        *strrchr(dir, '/') = '\0';
+    }
+    return -1;
+}
+// Parse a kernel style CPU list ("0-7,16-23"), an empty set and false if malformed
+static bool parse_cpu_list(const char *list, cpu_set_t *cpus) {
+    CPU_ZERO(cpus);
+    const char *p = list;
+    while (*p && *p != '\n') {
+        char *end;
+        long first = strtol(p, &end, 10);
+        long last = first;
+        if (end != p && *end == '-') {
+            p = end + 1;
+            last = strtol(p, &end, 10);
+        }
+        if (end == p || first < 0 || last < first || (*end != ',' && *end != '\0' && *end != '\n')) {
+            CPU_ZERO(cpus);
+            return false;
+        }
+        for (long cpu = first; cpu <= last && cpu < CPU_SETSIZE; cpu++) {
+            CPU_SET(cpu, cpus);
+        }
+        p = (*end == ',') ? end + 1 : end;
+    }
+    return CPU_COUNT(cpus) > 0;
+}
+
+// CPUs of a node from /sys/devices/system/node/node<N>/cpulist
+static bool numa_node_cpus(int node, cpu_set_t *cpus) {
+    char file[64];
+    char list[1024];
+    snprintf(file, sizeof(file), "/sys/devices/system/node/node%d/cpulist", node);
+    FILE *fp = fopen(file, "r");
+    if (!fp) {
+        return false;
+    }
+    bool ok = fgets(list, sizeof(list), fp) && parse_cpu_list(list, cpus);
+    fclose(fp);
+    return ok;
+}
+
+// Move the calling worker onto a node's CPUs (within --cpus), buffers it allocates
+// afterwards follow. An explicit --pin keeps the worker where it is, only buffers move.
+static void numa_place_thread(int node) {
+    if (node < 0 || node == t_numa_node) {
+        return;
+    }
+
+    cpu_set_t cpus;
+    if (g_options.pin == PIN_NONE && numa_node_cpus(node, &cpus)) {
+        if (g_options.has_cpus) {
+            CPU_AND(&cpus, &cpus, &g_options.cpus);
+            if (CPU_COUNT(&cpus) == 0) {
+                cpus = g_options.cpus;
+            }
+        }
+        pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+    }
+    t_numa_node = node;
+}
+
+// Worker placement (--cpus, --pin): pool workers are bound to CPUs in an order that
+// packs or spreads them over the machine's topology
+typedef struct {
+    int cpu;
+    int keys[3];  // Sort keys, most significant first, filled in per --pin policy
+} PinSlot;
+
+// Topology of one CPU from sysfs: socket, core and its index among its SMT siblings
+static void read_cpu_topology(int cpu, int *package, int *core, int *thread) {
+    char file[96];
+    char list[256];
+    *package = *core = *thread = 0;
+
+    snprintf(file, sizeof(file), "/sys/devices/system/cpu/cpu%d/topology/physical_package_id", cpu);
+    FILE *fp = fopen(file, "r");
+    if (fp) {
+        if (fscanf(fp, "%d", package) != 1) *package = 0;
+        fclose(fp);
+    }
+    snprintf(file, sizeof(file), "/sys/devices/system/cpu/cpu%d/topology/core_id", cpu);
+    fp = fopen(file, "r");
+    if (fp) {
+        if (fscanf(fp, "%d", core) != 1) *core = 0;
+        fclose(fp);
+    }
+    snprintf(file, sizeof(file), "/sys/devices/system/cpu/cpu%d/topology/thread_siblings_list", cpu);
+    fp = fopen(file, "r");
+    cpu_set_t siblings;
+    if (fp && fgets(list, sizeof(list), fp) && parse_cpu_list(list, &siblings)) {
+        for (int i = 0; i < cpu; i++) {
+            *thread += CPU_ISSET(i, &siblings) ? 1 : 0;
+        }
+    }
+    if (fp) {
+        fclose(fp);
+    }
+}
+
+static int compare_pin_slots(const void *a, const void *b) {
+    const PinSlot *sa = (const PinSlot *)a;
+    const PinSlot *sb = (const PinSlot *)b;
+    for (int i = 0; i < 3; i++) {
+        if (sa->keys[i] != sb->keys[i]) {
+            return (sa->keys[i] > sb->keys[i]) - (sa->keys[i] < sb->keys[i]);
+        }
+    }
+    return (sa->cpu > sb->cpu) - (sa->cpu < sb->cpu);
+}
+
+// CPUs workers may use: --cpus, or whatever this process is allowed to run on
+static void allowed_cpus(cpu_set_t *cpus) {
+    if (g_options.has_cpus) {
+        *cpus = g_options.cpus;
+    } else if (sched_getaffinity(0, sizeof(*cpus), cpus) != 0) {
+        CPU_ZERO(cpus);
+    }
+}
+
+// The order in which workers are bound to CPUs under the --pin policy,
+// worker i runs on cpus[i % count]. Returns the count, 0 when not pinning.
+static int build_pin_order(int **cpus) {
+    *cpus = NULL;
+    if (g_options.pin == PIN_NONE) {
+        return 0;
+    }
+
+    cpu_set_t allowed;
+    allowed_cpus(&allowed);
+    PinSlot *slots = malloc(sizeof(PinSlot) * CPU_COUNT(&allowed));
+    int count = 0;
+
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+        if (!CPU_ISSET(cpu, &allowed)) {
+            continue;
+        }
+        int package, core, thread;
+        read_cpu_topology(cpu, &package, &core, &thread);
+
+        PinSlot *slot = &slots[count++];
+        slot->cpu = cpu;
+        switch (g_options.pin) {
+            case PIN_COMPACT:
+                // Fill a socket core by core, SMT siblings next to each other
+                slot->keys[0] = package;
+                slot->keys[1] = core;
+                slot->keys[2] = thread;
+                break;
+            case PIN_CORES:
+                // One worker per physical core first, SMT siblings only once all cores are used
+                slot->keys[0] = thread;
+                slot->keys[1] = package;
+                slot->keys[2] = core;
+                break;
+            case PIN_SOCKETS:
+                // Alternate sockets, then cores, then SMT siblings
+                slot->keys[0] = thread;
+                slot->keys[1] = core;
+                slot->keys[2] = package;
+                break;
+            case PIN_NONE:
+                break;
+        }
+    }
+    qsort(slots, count, sizeof(PinSlot), compare_pin_slots);
+
+    *cpus = malloc(sizeof(int) * (count > 0 ? count : 1));
+    for (int i = 0; i < count; i++) {
+        (*cpus)[i] = slots[i].cpu;
+    }
+    free(slots);
+    return count;
+}
+
+// Format a CPU mask as a list ("0-3,8"), the inverse of parse_cpu_list()
+static void format_cpu_list(const cpu_set_t *cpus, char *out, size_t out_size) {
+    size_t used = 0;
+    out[0] = '\0';
+    for (int cpu = 0; cpu < CPU_SETSIZE && used < out_size; cpu++) {
+        if (!CPU_ISSET(cpu, cpus)) {
+            continue;
+        }
+        int last = cpu;
+        while (last + 1 < CPU_SETSIZE && CPU_ISSET(last + 1, cpus)) {
+            last++;
+        }
+        used += snprintf(out + used, out_size - used, last > cpu ? "%s%d-%d" : "%s%d",
+                         used ? "," : "", cpu, last);
+        cpu = last;
+    }
+    if (used == 0) {
+        snprintf(out, out_size, "-");
+    }
+}
+
+#ifndef MAP_HUGE_2MB
+#define MAP_HUGE_2MB (21 << MAP_HUGE_SHIFT)
+#endif
+#ifndef MAP_HUGE_1GB
+#define MAP_HUGE_1GB (30 << MAP_HUGE_SHIFT)
+#endif
+#define THP_SIZE (2 * 1024 * 1024)
+
+static atomic_int g_huge_page_fallbacks;  // hugetlb requests served by THP instead
+
+// Map size bytes of reserved hugetlb pages, NULL if not enough are reserved
+static void *map_hugetlb_buffer(size_t *size, bool gigantic) {
+    size_t huge_size = gigantic ? 1024UL * 1024 * 1024 : 2UL * 1024 * 1024;
+    size_t mapped = align_up(*size, huge_size);
+    void *addr = mmap(NULL, mapped, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | (gigantic ? MAP_HUGE_1GB : MAP_HUGE_2MB),
+                      -1, 0);
+    if (addr == MAP_FAILED) {
+        return NULL;
+    }
+    *size = mapped;
+    return addr;
+}
+
+// Allocate fresh buffer memory: huge pages under --huge-pages and, on a placed worker,
+// preferring the worker's node. size is updated to what was actually reserved,
+// *hugetlb tells whether it has to be unmapped rather than freed.
+static int alloc_buffer_memory(void **buffer, size_t alignment, size_t *size, bool *hugetlb) {
+    size_t page_size = sysconf(_SC_PAGESIZE);
+    HugePagePolicy huge = g_options.huge_pages;
+    *buffer = NULL;
+    *hugetlb = false;
+
+    if (huge == HUGE_PAGES_2M || huge == HUGE_PAGES_1G) {
+        *buffer = map_hugetlb_buffer(size, huge == HUGE_PAGES_1G);
+        *hugetlb = (*buffer != NULL);
+        if (!*buffer) {
+            // Nothing reserved in /proc/sys/vm/nr_hugepages (or the 1G pool), ask for THP
+            atomic_fetch_add(&g_huge_page_fallbacks, 1);
+            huge = HUGE_PAGES_THP;
+        }
+    }
+
+    if (!*buffer) {
+        // THP needs 2MB aligned extents, mbind and pre-faulting need whole pages
+        size_t unit = (huge == HUGE_PAGES_THP) ? THP_SIZE : page_size;
+        *size = align_up(*size, unit);
+        int ret = posix_memalign(buffer, (alignment > unit) ? alignment : unit, *size);
+        if (ret != 0) {
+            return ret;
+        }
+        if (huge == HUGE_PAGES_THP) {
+            madvise(*buffer, *size, MADV_HUGEPAGE);
+        }
+    }
+
+    if (t_numa_node >= 0) {
+        unsigned long mask[NUMA_MAX_NODES / (8 * sizeof(unsigned long))] = {0};
+        mask[t_numa_node / (8 * sizeof(unsigned long))] |= 1UL << (t_numa_node % (8 * sizeof(unsigned long)));
+        // Best effort: without the policy first touch from the pinned worker still lands locally
+        syscall(__NR_mbind, *buffer, *size, MPOL_PREFERRED, mask, NUMA_MAX_NODES + 1, 0);
+    }
+
+    // Fault every page in now, so first-touch cost is not timed as copy time
+    for (size_t offset = 0; offset < *size; offset += page_size) {
+        ((volatile char *)*buffer)[offset] = 0;
+    }
+    return 0;
+}
+
+// Process-wide pool of I/O buffers. Workers borrow a buffer per copy and return it,
+// so memory follows the number of concurrent copies rather than the number of files,
+// and each buffer is allocated and faulted in once. --buffer-budget caps the bytes the
+// pool owns; borrowers wait for returns when it is reached.
+typedef struct PooledBuffer {
+    void *addr;
+    size_t size;            // Bytes reserved, rounded up to the page size in use
+    size_t requested;       // Size originally asked for
+    size_t alignment;
+    int node;               // NUMA node it was bound to, -1 if none
+    HugePagePolicy huge;
+    bool hugetlb;
+    bool borrowed;
+    struct PooledBuffer *next;
+} PooledBuffer;
+
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t returned;
+    PooledBuffer *buffers;  // Every buffer the pool owns, borrowed or idle
+    uint64_t owned;         // Bytes allocated, including reservations being allocated
+    uint64_t borrowed;      // Bytes currently lent out
+    // Reported after the copy
+    uint64_t peak;
+    int allocations;
+    int reuses;
+    int waits;
+} BufferPool;
+
+static BufferPool g_buffer_pool = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .returned = PTHREAD_COND_INITIALIZER,
+};
+
+static void release_pooled_buffer(PooledBuffer *buffer) {
+    if (buffer->hugetlb) {
+        munmap(buffer->addr, buffer->size);
+    } else {
+        free(buffer->addr);
+    }
+    free(buffer);
+}
+
+// Free idle buffers until the pool owns no more than target bytes, called with the lock held
+static void buffer_pool_shrink(uint64_t target) {
+    for (PooledBuffer **link = &g_buffer_pool.buffers; *link && g_buffer_pool.owned > target;) {
+        PooledBuffer *buffer = *link;
+        if (buffer->borrowed) {
+            link = &buffer->next;
+            continue;
+        }
+        *link = buffer->next;
+        g_buffer_pool.owned -= buffer->size;
+        release_pooled_buffer(buffer);
+    }
+}
+
+// Borrow an I/O buffer of at least size bytes from the pool. An idle buffer of up to
+// twice the size is reused, otherwise a new one is allocated within the budget.
+// A request is always granted when nothing is lent out, even past the budget.
+// Return it with free_io_buffer().
+static int alloc_io_buffer(void **buffer, size_t alignment, size_t size) {
+    BufferPool *pool = &g_buffer_pool;
+    uint64_t budget = g_options.buffer_budget;
+
+    pthread_mutex_lock(&pool->lock);
+    for (;;) {
+        PooledBuffer *best = NULL;
+        for (PooledBuffer *candidate = pool->buffers; candidate; candidate = candidate->next) {
+            if (!candidate->borrowed && candidate->size >= size && candidate->requested <= 2 * size &&
+                candidate->alignment >= alignment && candidate->node == t_numa_node &&
+                candidate->huge == g_options.huge_pages && (!best || candidate->size < best->size)) {
+                best = candidate;
+            }
+        }
+        if (best) {
+            best->borrowed = true;
+            pool->borrowed += best->size;
+            pool->reuses++;
+            pthread_mutex_unlock(&pool->lock);
+            *buffer = best->addr;
+            return 0;
+        }
+
+        if (budget == 0 || pool->owned + size <= budget) {
+            break;
+        }
+        // Idle buffers of other sizes make room first
+        buffer_pool_shrink(budget > size ? budget - size : 0);
+        if (pool->owned + size <= budget || pool->borrowed == 0) {
+            break;
+        }
+        pool->waits++;
+        pthread_cond_wait(&pool->returned, &pool->lock);
+    }
+    // Reserve the bytes so concurrent borrowers see them while we allocate unlocked
+    pool->owned += size;
+    pool->borrowed += size;
+    pthread_mutex_unlock(&pool->lock);
+
+    PooledBuffer *entry = calloc(1, sizeof(PooledBuffer));
+    size_t allocated = size;
+    int ret = entry ? alloc_buffer_memory(&entry->addr, alignment, &allocated, &entry->hugetlb) : ENOMEM;
+
+    pthread_mutex_lock(&pool->lock);
+    pool->owned -= size;
+    pool->borrowed -= size;
+    if (ret == 0) {
+        entry->size = allocated;
+        entry->requested = size;
+        entry->alignment = alignment;
+        entry->node = t_numa_node;
+        entry->huge = g_options.huge_pages;
+        entry->borrowed = true;
+        entry->next = pool->buffers;
+        pool->buffers = entry;
+        pool->owned += allocated;
+        pool->borrowed += allocated;
+        pool->allocations++;
+        if (pool->owned > pool->peak) {
+            pool->peak = pool->owned;
+        }
+        *buffer = entry->addr;
+    } else {
+        free(entry);
+        pthread_cond_broadcast(&pool->returned);
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return ret;
+}
+
+// Return a buffer borrowed with alloc_io_buffer() to the pool
+static void free_io_buffer(void *buffer) {
+    if (!buffer) {
+        return;
+    }
+
+    pthread_mutex_lock(&g_buffer_pool.lock);
+    for (PooledBuffer *entry = g_buffer_pool.buffers; entry; entry = entry->next) {
+        if (entry->addr == buffer) {
+            entry->borrowed = false;
+            g_buffer_pool.borrowed -= entry->size;
+            break;
+        }
+    }
+    pthread_cond_broadcast(&g_buffer_pool.returned);
+    pthread_mutex_unlock(&g_buffer_pool.lock);
+}
+
+// Release every idle buffer back to the system
+static void buffer_pool_drain(void) {
+    pthread_mutex_lock(&g_buffer_pool.lock);
+    buffer_pool_shrink(0);
+    pthread_mutex_unlock(&g_buffer_pool.lock);
+}
+
+// Borrow count buffers of size bytes on node (-1 for unplaced workers) and return
+// them, so the copy that follows finds them allocated and faulted in. Stops short of
+// the budget so it never has to wait.
+static void buffer_pool_prefill(int count, int node, size_t alignment, size_t size) {
+    void **buffers = calloc(count, sizeof(void *));
+    if (!buffers) {
+        return;
+    }
+    // Pooled buffers are matched by node, so allocate as a worker placed there would
+    int placed = t_numa_node;
+    t_numa_node = node;
+    int borrowed = 0;
+    while (borrowed < count && (g_options.buffer_budget == 0 ||
+                                g_buffer_pool.owned + size <= g_options.buffer_budget)) {
+        if (alloc_io_buffer(&buffers[borrowed], alignment, size) != 0) {
+            break;
+        }
+        borrowed++;
+    }
+    t_numa_node = placed;
+    for (int i = 0; i < borrowed; i++) {
+        free_io_buffer(buffers[i]);
+    }
+    free(buffers);
+}
+
+// Copy kernels for the CPU-side copies (mmap, direct_io_memory_impact), chosen with
+// --copy-kernel. Non-temporal stores skip the read-for-ownership a regular store does
+// on a cache miss, so a large copy moves two bytes per byte instead of three.
+typedef void *(*CopyFunction)(void *dst, const void *src, size_t n);
+
+#define COPY_PREFETCH_DISTANCE 1024  // Bytes the prefetching loop reads ahead
+#define NT_COPY_MIN_SIZE 4096        // Below this a streaming loop is all head and tail
+
+static void *copy_libc(void *dst, const void *src, size_t n) {
+    return memcpy(dst, src, n);
+}
+
+// Cache-line loop that prefetches ahead of the loads
+static void *copy_prefetch(void *dst, const void *src, size_t n) {
+    char *d = (char *)dst;
+    const char *s = (const char *)src;
+    size_t i = 0;
+    for (; i + 64 <= n; i += 64) {
+        __builtin_prefetch(s + i + COPY_PREFETCH_DISTANCE, 0, 0);
+        memcpy(d + i, s + i, 64);
+    }
+    memcpy(d + i, s + i, n - i);
+    return dst;
+}
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+
+// Microcoded string copy, fast on CPUs with ERMS/FSRM
+static void *copy_rep_movsb(void *dst, const void *src, size_t n) {
+    void *d = dst;
+    __asm__ volatile("rep movsb" : "+D"(d), "+S"(src), "+c"(n) : : "memory");
+    return dst;
+}
+
+__attribute__((target("avx2")))
+static void *copy_avx2_nt(void *dst, const void *src, size_t n) {
+    if (n < NT_COPY_MIN_SIZE) {
+        return memcpy(dst, src, n);
+    }
+    char *d = (char *)dst;
+    const char *s = (const char *)src;
+
+    // Streaming stores need an aligned destination
+    size_t head = (32 - ((uintptr_t)d & 31)) & 31;
+    memcpy(d, s, head);
+    size_t i = head;
+    for (; i + 128 <= n; i += 128) {
+        __m256i v0 = _mm256_loadu_si256((const __m256i *)(s + i));
+        __m256i v1 = _mm256_loadu_si256((const __m256i *)(s + i + 32));
+        __m256i v2 = _mm256_loadu_si256((const __m256i *)(s + i + 64));
+        __m256i v3 = _mm256_loadu_si256((const __m256i *)(s + i + 96));
+        _mm256_stream_si256((__m256i *)(d + i), v0);
+        _mm256_stream_si256((__m256i *)(d + i + 32), v1);
+        _mm256_stream_si256((__m256i *)(d + i + 64), v2);
+        _mm256_stream_si256((__m256i *)(d + i + 96), v3);
+    }
+    // Streaming stores are weakly ordered, fence before anyone reads the result
+    _mm_sfence();
+    memcpy(d + i, s + i, n - i);
+    return dst;
+}
+
+__attribute__((target("avx512f")))
+static void *copy_avx512_nt(void *dst, const void *src, size_t n) {
+    if (n < NT_COPY_MIN_SIZE) {
+        return memcpy(dst, src, n);
+    }
+    char *d = (char *)dst;
+    const char *s = (const char *)src;
+
+    size_t head = (64 - ((uintptr_t)d & 63)) & 63;
+    memcpy(d, s, head);
+    size_t i = head;
+    for (; i + 256 <= n; i += 256) {
+        __m512i v0 = _mm512_loadu_si512((const void *)(s + i));
+        __m512i v1 = _mm512_loadu_si512((const void *)(s + i + 64));
+        __m512i v2 = _mm512_loadu_si512((const void *)(s + i + 128));
+        __m512i v3 = _mm512_loadu_si512((const void *)(s + i + 192));
+        _mm512_stream_si512((void *)(d + i), v0);
+        _mm512_stream_si512((void *)(d + i + 64), v1);
+        _mm512_stream_si512((void *)(d + i + 128), v2);
+        _mm512_stream_si512((void *)(d + i + 192), v3);
+    }
+    _mm_sfence();
+    memcpy(d + i, s + i, n - i);
+    return dst;
+}
+#endif
+
+static const struct {
+    const char *name;
+    CopyFunction fn;  // NULL when not built for this architecture
+} copy_kernels[NUM_COPY_KERNELS] = {
+    [COPY_KERNEL_AUTO] = {"auto", NULL},
+    [COPY_KERNEL_LIBC] = {"libc", copy_libc},
+    [COPY_KERNEL_PREFETCH] = {"prefetch", copy_prefetch},
+#if defined(__x86_64__)
+    [COPY_KERNEL_REP_MOVSB] = {"rep_movsb", copy_rep_movsb},
+    [COPY_KERNEL_AVX2_NT] = {"avx2_nt", copy_avx2_nt},
+    [COPY_KERNEL_AVX512_NT] = {"avx512_nt", copy_avx512_nt},
+#else
+    [COPY_KERNEL_REP_MOVSB] = {"rep_movsb", NULL},
+    [COPY_KERNEL_AVX2_NT] = {"avx2_nt", NULL},
+    [COPY_KERNEL_AVX512_NT] = {"avx512_nt", NULL},
+#endif
+};
+
+// Whether this build and CPU can run the kernel (CPUID through the compiler builtins)
+static bool copy_kernel_available(CopyKernel kernel) {
+    if (kernel <= COPY_KERNEL_AUTO || kernel >= NUM_COPY_KERNELS || !copy_kernels[kernel].fn) {
+        return false;
+    }
+#if defined(__x86_64__)
+    __builtin_cpu_init();
+    if (kernel == COPY_KERNEL_AVX2_NT) return __builtin_cpu_supports("avx2");
+    if (kernel == COPY_KERNEL_AVX512_NT) return __builtin_cpu_supports("avx512f");
+#endif
+    return true;
+}
+
+// Kernel auto picks: the widest streaming kernel the CPU has, since both callers
+// copy working sets far larger than the caches
+static CopyKernel resolve_copy_kernel(CopyKernel kernel) {
+    if (kernel != COPY_KERNEL_AUTO) {
+        return kernel;
+    }
+    if (copy_kernel_available(COPY_KERNEL_AVX512_NT)) return COPY_KERNEL_AVX512_NT;
+    if (copy_kernel_available(COPY_KERNEL_AVX2_NT)) return COPY_KERNEL_AVX2_NT;
+    return COPY_KERNEL_LIBC;
+}
+
+// Resolved once by validate_copy_options(), like an ifunc
+static CopyFunction g_copy_function = copy_libc;
+
+// Simplified system cp command copy function
+static int copy_using_cp(const char *src, const char *dst) {
+    char command[1024];
+    snprintf(command, sizeof(command), "cp %s %s", src, dst);
+    return system(command);
+}
+
+// Simplified mmap copy function
+static int copy_using_mmap(const char *src, const char *dst, size_t file_size) {
+    int src_fd = open(src, O_RDONLY);
+    int dst_fd = open(dst, O_RDWR | O_CREAT, 0644);
+    if (src_fd < 0 || dst_fd < 0) {
+        return -1;
+    }
+
+    if (ftruncate(dst_fd, file_size) != 0) {
+        close(src_fd);
+        close(dst_fd);
+        return -1;
+    }
+
+    size_t remaining = file_size;
+    size_t offset = 0;
+
     while (remaining > 0) {
-        size_t to_write = (remaining < buf_size) ? remaining : buf_size;
-        // Ensure write size is multiple of 512 (for O_DIRECT)
-        to_write = (to_write / 512) * 512;
+        size_t chunk_size = (remaining < g_options.mmap_chunk_size) ? remaining : g_options.mmap_chunk_size;
         
-        ssize_t written = write(fd, buf, to_write);
-        if (written < 0) {
-            perror("write");
-            free(buf);
-            close(fd);
+        void *src_map = mmap(NULL, chunk_size, PROT_READ, MAP_PRIVATE, src_fd, offset);
+        void *dst_map = mmap(NULL, chunk_size, PROT_WRITE, MAP_SHARED, dst_fd, offset);
+        
+        if (src_map == MAP_FAILED || dst_map == MAP_FAILED) {
+            close(src_fd);
+            close(dst_fd);
             return -1;
         }
-        remaining -= written;
+
+        g_copy_function(dst_map, src_map, chunk_size);
+        uint64_t sync_ns = monotonic_ns();
+        msync(dst_map, chunk_size, MS_SYNC);
+        latency_record(LATENCY_SYNC, sync_ns);
+        progress_add(chunk_size);
+        
+        munmap(src_map, chunk_size);
+        munmap(dst_map, chunk_size);
+        
+        remaining -= chunk_size;
+        offset += chunk_size;
+    }
+
+    close(src_fd);
+    close(dst_fd);
+    return 0;
+}
+
+// Single-producer/single-consumer ring of aligned buffers between the direct I/O
+// reader and writer. Only the reader advances tail and only the writer advances head.
+typedef struct {
+    char **buffers;
+    size_t *lengths;
+    uint64_t *offsets;
+    uint64_t *issued_ns;  // When the read started, for the adaptive budget
+    int size;
+    atomic_uint_fast64_t head;  // Next buffer the writer drains
+    atomic_uint_fast64_t tail;  // Next buffer the reader fills
+    atomic_bool reader_done;
+    atomic_bool failed;
+} BufferRing;
+
+typedef struct {
+    BufferRing *ring;
+    int src_fd;
+    CopyRange *range;
+    size_t buffer_size;
+} DirectIoReader;
+
+// Spin briefly, then sleep, while the other side of the ring catches up
+static void ring_backoff(int *spins) {
+    if (++(*spins) < 64) {
+        sched_yield();
+    } else {
+        struct timespec ts = {0, 50 * 1000};
+        nanosleep(&ts, NULL);
+    }
+}
+
+// Producer: fills free buffers with blocks claimed from the range until it is exhausted
+static void *direct_io_reader_thread(void *arg) {
+    DirectIoReader *reader = (DirectIoReader *)arg;
+    BufferRing *ring = reader->ring;
+
+    for (;;) {
+        uint64_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+        int spins = 0;
+        while (tail - atomic_load_explicit(&ring->head, memory_order_acquire) >= (uint64_t)ring->size) {
+            if (atomic_load_explicit(&ring->failed, memory_order_relaxed)) {
+                return NULL;
+            }
+            ring_backoff(&spins);
+        }
+
+        // Buffers still in the ring hold budget, so only wait for more while the ring is empty
+        spins = 0;
+        while (!inflight_acquire(reader->buffer_size,
+                                 tail == atomic_load_explicit(&ring->head, memory_order_acquire))) {
+            if (atomic_load_explicit(&ring->failed, memory_order_relaxed)) {
+                return NULL;
+            }
+            ring_backoff(&spins);
+        }
+
+        // Claim only once a buffer is free, so idle workers can still split the rest
+        uint64_t offset;
+        size_t length;
+        if (!range_claim(reader->range, reader->buffer_size, &offset, &length)) {
+            inflight_release(reader->buffer_size, 0, 0);
+            break;
+        }
+
+        // O_DIRECT needs aligned lengths, only the file tail is padded
+        int index = tail % ring->size;
+        ring->issued_ns[index] = monotonic_ns();
+        ssize_t bytes_read = pread(reader->src_fd, ring->buffers[index], align_up(length, g_options.align), offset);
+        latency_record(LATENCY_READ, ring->issued_ns[index]);
+        if (bytes_read < (ssize_t)length) {
+            inflight_release(reader->buffer_size, 0, 0);
+            atomic_store_explicit(&ring->failed, true, memory_order_relaxed);
+            break;
+        }
+
+        ring->lengths[index] = align_up(length, g_options.align);
+        ring->offsets[index] = offset;
+        atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+    }
+
+    atomic_store_explicit(&ring->reader_done, true, memory_order_release);
+    return NULL;
+}
+
+// Direct I/O copy loop: a reader thread fills a ring of aligned buffers while
+// this thread writes them out, so source and destination devices work concurrently
+static int direct_io_pipeline_copy_range(int src_fd, int dst_fd, CopyRange *range) {
+    // Split the read budget across the ring so the footprint stays --read-size
+    const int num_buffers = g_options.direct_io_buffers;
+    const size_t buffer_size = (g_options.read_size / num_buffers) / g_options.align * g_options.align;
+
+    BufferRing ring;
+    ring.size = num_buffers;
+    ring.buffers = calloc(num_buffers, sizeof(char *));
+    ring.lengths = calloc(num_buffers, sizeof(size_t));
+    ring.offsets = calloc(num_buffers, sizeof(uint64_t));
+    ring.issued_ns = calloc(num_buffers, sizeof(uint64_t));
+    atomic_init(&ring.head, 0);
+    atomic_init(&ring.tail, 0);
+    atomic_init(&ring.reader_done, false);
+    atomic_init(&ring.failed, false);
+
+    // Allocate aligned buffers
+    void *buffer = NULL;
+    if (!ring.buffers || !ring.lengths || !ring.offsets || !ring.issued_ns ||
+        alloc_io_buffer(&buffer, g_options.align, buffer_size * num_buffers) != 0) {
+        free(ring.buffers);
+        free(ring.lengths);
+        free(ring.offsets);
+        free(ring.issued_ns);
+        return -1;
+    }
+    for (int i = 0; i < num_buffers; i++) {
+        ring.buffers[i] = (char *)buffer + (size_t)i * buffer_size;
+    }
+
+    DirectIoReader reader = {&ring, src_fd, range, buffer_size};
+    pthread_t reader_thread;
+    if (pthread_create(&reader_thread, NULL, direct_io_reader_thread, &reader) != 0) {
+        free_io_buffer(buffer);
+        free(ring.buffers);
+        free(ring.lengths);
+        free(ring.offsets);
+        free(ring.issued_ns);
+        return -1;
+    }
+
+    // Consumer: drain filled buffers in order until the reader is done
+    for (;;) {
+        uint64_t head = atomic_load_explicit(&ring.head, memory_order_relaxed);
+        int spins = 0;
+        while (atomic_load_explicit(&ring.tail, memory_order_acquire) == head) {
+            if (atomic_load_explicit(&ring.failed, memory_order_relaxed) ||
+                atomic_load_explicit(&ring.reader_done, memory_order_acquire)) {
+                break;
+            }
+            ring_backoff(&spins);
+        }
+        // reader_done is published after the last tail update, so re-check once
+        if (atomic_load_explicit(&ring.tail, memory_order_acquire) == head ||
+            atomic_load_explicit(&ring.failed, memory_order_relaxed)) {
+            break;
+        }
+
+        int index = head % ring.size;
+        uint64_t write_ns = monotonic_ns();
+        ssize_t bytes_written = pwrite(dst_fd, ring.buffers[index], ring.lengths[index],
+                                       ring.offsets[index]);
+        latency_record(LATENCY_WRITE, write_ns);
+        if (bytes_written != (ssize_t)ring.lengths[index]) {
+            atomic_store_explicit(&ring.failed, true, memory_order_relaxed);
+            break;
+        }
+
+        inflight_release(buffer_size, ring.lengths[index], ring.issued_ns[index]);
+        progress_add(ring.lengths[index]);
+        atomic_store_explicit(&ring.head, head + 1, memory_order_release);
+    }
+
+    pthread_join(reader_thread, NULL);
+
+    // Buffers read but never written after a failure still hold budget
+    for (uint64_t i = atomic_load(&ring.head); i < atomic_load(&ring.tail); i++) {
+        inflight_release(buffer_size, 0, 0);
+    }
+
+    free_io_buffer(buffer);
+    free(ring.buffers);
+    free(ring.lengths);
+    free(ring.offsets);
+    free(ring.issued_ns);
+    return atomic_load(&ring.failed) ? -1 : 0;
+}
+
+// Add new copy function
+// Simulated DMA pass of direct_io_memory_impact: move total bytes from src to dst in
+// windows of window bytes (the buffers' size), dma_block_size at a time, reading one
+// word per page of every block back. Returns the checksum of the words read.
+static uint64_t simulate_dma_copy(const char *src_buffer, char *dst_buffer, size_t total, size_t window) {
+    // Use system page size as base alignment unit
+    const size_t page_size = sysconf(_SC_PAGESIZE);
+    // Simulated DMA transfer block size, 2MB by default
+    const size_t dma_block_size = g_options.dma_block_size;
+
+    size_t remaining = total;
+    volatile uint64_t checksum = 0;
+
+    while (remaining > 0) {
+        size_t current_chunk = (remaining < window) ? remaining : window;
+        size_t chunk_remaining = current_chunk;
+        
+        const char *chunk_src = src_buffer;
+        char *chunk_dst = dst_buffer;
+        
+        // Transfer by DMA block size
+        while (chunk_remaining >= dma_block_size) {
+            chunk_dst = (char *)g_copy_function(chunk_dst, chunk_src, dma_block_size) + dma_block_size;
+            chunk_src += dma_block_size;
+            chunk_remaining -= dma_block_size;
+            
+            // Verify after each DMA block transfer
+            for (size_t i = 0; i < dma_block_size; i += page_size) {
+                checksum ^= *(volatile uint64_t *)(chunk_dst - dma_block_size + i);
+            }
+        }
+        
+        // Handle remaining bytes
+        if (chunk_remaining > 0) {
+            // Ensure remaining portion is also page-aligned
+            size_t aligned_remaining = (chunk_remaining + page_size - 1) & ~(page_size - 1);
+            chunk_dst = (char *)g_copy_function(chunk_dst, chunk_src, aligned_remaining) + aligned_remaining;
+            
+            // Verify remaining portion
+            for (size_t i = 0; i < aligned_remaining; i += page_size) {
+                checksum ^= *(volatile uint64_t *)(chunk_dst - aligned_remaining + i);
+            }
+        }
+        
+        remaining -= current_chunk;
+        progress_add(current_chunk);
+    }
+
+    return checksum;
+}
+
+static int copy_using_direct_io_memory_impact(const char *src, const char *dst, size_t file_size) {
+    const size_t page_size = sysconf(_SC_PAGESIZE);
+    void *buffer = NULL;
+    
+    // One page-aligned borrow holds both halves, so a tight --buffer-budget cannot
+    // leave workers each holding a source half while waiting for a destination half
+    if (alloc_io_buffer(&buffer, page_size, 2 * g_options.read_size) != 0) {
+        return -1;
+    }
+    void *src_buffer = buffer;
+    void *dst_buffer = (char *)buffer + g_options.read_size;
+
+    // Replace original random data generation code
+    RandomGenerator gen;
+    init_random_generator(&gen);
+    fill_buffer_with_random_data(&gen, src_buffer, g_options.read_size);
+
+    // Force memory barrier to ensure initialization is complete
+    __sync_synchronize();
+
+    // Simulate DMA transfer process
+    uint64_t checksum = simulate_dma_copy(src_buffer, dst_buffer, file_size, g_options.read_size);
+
+    free_io_buffer(buffer);
+    
+    return (checksum != 0) ? 0 : -1;
+}
+
+// One in-flight request per slot: a block is read, then written from the same buffer
+typedef struct {
+    char *buffer;
+    uint64_t offset;
+    size_t claimed;  // Bytes of the range this block covers
+    size_t length;   // Request length, claimed padded up to the alignment for O_DIRECT
+    bool busy;       // Copying a block, from its read until its write completes
+    bool writing;
+    uint64_t issued_ns;
+    uint64_t op_ns;  // When the current read or write was queued, for the latency histogram
+} AsyncSlot;
+
+// Start the next block on an idle slot: 1 if started, 0 if the in-flight budget
+// is used up, -1 once the range is exhausted
+static int async_slot_start(AsyncSlot *slot, CopyRange *range, size_t block_size, bool may_block) {
+    if (!inflight_acquire(block_size, may_block)) {
+        return 0;
+    }
+    if (!range_claim(range, block_size, &slot->offset, &slot->claimed)) {
+        inflight_release(block_size, 0, 0);
+        return -1;
+    }
+    slot->length = align_up(slot->claimed, g_options.align);
+    slot->busy = true;
+    slot->writing = false;
+    slot->issued_ns = monotonic_ns();
+    slot->op_ns = slot->issued_ns;
+    return 1;
+}
+
+// The slot's block is written (or failed), return its budget and make it idle
+static void async_slot_finish(AsyncSlot *slot, size_t block_size, bool copied) {
+    inflight_release(block_size, copied ? slot->claimed : 0, slot->issued_ns);
+    if (copied) {
+        progress_add(slot->claimed);
+    }
+    slot->busy = false;
+}
+
+// Minimal io_uring wrapper on top of the raw syscalls (no liburing needed)
+typedef struct {
+    int fd;
+    unsigned sq_entries;
+    unsigned *sq_head;
+    unsigned *sq_tail;
+    unsigned *sq_mask;
+    unsigned *sq_array;
+    unsigned *cq_head;
+    unsigned *cq_tail;
+    unsigned *cq_mask;
+    struct io_uring_sqe *sqes;
+    struct io_uring_cqe *cqes;
+    void *sq_ring;
+    void *cq_ring;
+    size_t sq_ring_size;
+    size_t cq_ring_size;
+    size_t sqes_size;
+    unsigned to_submit;
+} IoUring;
+
+static int io_uring_init(IoUring *ring, unsigned entries) {
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    memset(ring, 0, sizeof(*ring));
+
+    ring->fd = syscall(__NR_io_uring_setup, entries, &params);
+    if (ring->fd < 0) {
+        return -1;
+    }
+
+    ring->sq_entries = params.sq_entries;
+    ring->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+
+    // Newer kernels map both rings with a single mmap
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        if (ring->cq_ring_size > ring->sq_ring_size) {
+            ring->sq_ring_size = ring->cq_ring_size;
+        }
+        ring->cq_ring_size = ring->sq_ring_size;
+    }
+
+    ring->sq_ring = mmap(NULL, ring->sq_ring_size, PROT_READ | PROT_WRITE,
+                         MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+    if (ring->sq_ring == MAP_FAILED) {
+        close(ring->fd);
+        return -1;
+    }
+
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        ring->cq_ring = ring->sq_ring;
+    } else {
+        ring->cq_ring = mmap(NULL, ring->cq_ring_size, PROT_READ | PROT_WRITE,
+                             MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING);
+        if (ring->cq_ring == MAP_FAILED) {
+            munmap(ring->sq_ring, ring->sq_ring_size);
+            close(ring->fd);
+            return -1;
+        }
+    }
+
+    ring->sqes = mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+    if (ring->sqes == MAP_FAILED) {
+        if (ring->cq_ring != ring->sq_ring) {
+            munmap(ring->cq_ring, ring->cq_ring_size);
+        }
+        munmap(ring->sq_ring, ring->sq_ring_size);
+        close(ring->fd);
+        return -1;
+    }
+
+    char *sq = (char *)ring->sq_ring;
+    char *cq = (char *)ring->cq_ring;
+    ring->sq_head = (unsigned *)(sq + params.sq_off.head);
+    ring->sq_tail = (unsigned *)(sq + params.sq_off.tail);
+    ring->sq_mask = (unsigned *)(sq + params.sq_off.ring_mask);
+    ring->sq_array = (unsigned *)(sq + params.sq_off.array);
+    ring->cq_head = (unsigned *)(cq + params.cq_off.head);
+    ring->cq_tail = (unsigned *)(cq + params.cq_off.tail);
+    ring->cq_mask = (unsigned *)(cq + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe *)(cq + params.cq_off.cqes);
+    return 0;
+}
+
+static void io_uring_cleanup(IoUring *ring) {
+    munmap(ring->sqes, ring->sqes_size);
+    if (ring->cq_ring != ring->sq_ring) {
+        munmap(ring->cq_ring, ring->cq_ring_size);
+    }
+    munmap(ring->sq_ring, ring->sq_ring_size);
+    close(ring->fd);
+}
+
+// Queue one read or write; it is handed to the kernel by io_uring_submit_and_wait()
+static int io_uring_queue_rw(IoUring *ring, int opcode, int fd, void *buf,
+                             size_t len, uint64_t offset, uint64_t user_data) {
+    unsigned tail = *ring->sq_tail;
+    unsigned head = __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+    if (tail - head >= ring->sq_entries) {
+        return -1;
+    }
+
+    unsigned index = tail & *ring->sq_mask;
+    struct io_uring_sqe *sqe = &ring->sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = opcode;
+    sqe->fd = fd;
+    sqe->addr = (uint64_t)(uintptr_t)buf;
+    sqe->len = len;
+    sqe->off = offset;
+    sqe->user_data = user_data;
+    ring->sq_array[index] = index;
+
+    __atomic_store_n(ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+    ring->to_submit++;
+    return 0;
+}
+
+static int io_uring_submit_and_wait(IoUring *ring, unsigned wait_nr) {
+    int ret;
+    do {
+        ret = syscall(__NR_io_uring_enter, ring->fd, ring->to_submit, wait_nr,
+                      wait_nr ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+    } while (ret < 0 && errno == EINTR);
+
+    if (ret < 0) {
+        return -1;
+    }
+    ring->to_submit -= ret;
+    return 0;
+}
+
+// io_uring copy loop: keeps queue_depth reads/writes in flight over the range
+static int io_uring_copy_range(int src_fd, int dst_fd, CopyRange *range) {
+    const size_t block_size = g_options.block_size;
+    const int queue_depth = g_options.queue_depth;
+
+    IoUring ring;
+    if (io_uring_init(&ring, queue_depth) != 0) {
+        perror("io_uring_setup");
+        return -1;
+    }
+
+    void *buffer = NULL;
+    AsyncSlot *slots = calloc(queue_depth, sizeof(AsyncSlot));
+    if (!slots || alloc_io_buffer(&buffer, g_options.align, block_size * queue_depth) != 0) {
+        free(slots);
+        io_uring_cleanup(&ring);
+        return -1;
+    }
+
+    int inflight = 0;
+    int error = 0;
+    bool exhausted = false;
+
+    for (int i = 0; i < queue_depth; i++) {
+        slots[i].buffer = (char *)buffer + (size_t)i * block_size;
+    }
+
+    for (;;) {
+        // Start a read on every idle slot the in-flight budget allows. O_DIRECT needs
+        // aligned lengths, the caller trims the file tail afterwards
+        for (int i = 0; i < queue_depth && !error && !exhausted; i++) {
+            if (slots[i].busy) {
+                continue;
+            }
+            int started = async_slot_start(&slots[i], range, block_size, inflight == 0);
+            if (started <= 0) {
+                exhausted = (started < 0);
+                break;
+            }
+            io_uring_queue_rw(&ring, IORING_OP_READ, src_fd, slots[i].buffer,
+                              slots[i].length, slots[i].offset, i);
+            inflight++;
+        }
+        if (inflight == 0) {
+            break;
+        }
+
+        if (io_uring_submit_and_wait(&ring, 1) != 0) {
+            if (errno != EAGAIN && errno != EBUSY) {
+                error = errno;
+                break;
+            }
+            // Out of kernel resources or the completion queue is full: reap what has
+            // completed and submit the rest again next round
+            sched_yield();
+        }
+
+        unsigned head = *ring.cq_head;
+        unsigned tail = __atomic_load_n(ring.cq_tail, __ATOMIC_ACQUIRE);
+        for (; head != tail; head++) {
+            struct io_uring_cqe *cqe = &ring.cqes[head & *ring.cq_mask];
+            AsyncSlot *slot = &slots[cqe->user_data];
+            int res = cqe->res;
+            latency_record(slot->writing ? LATENCY_WRITE : LATENCY_READ, slot->op_ns);
+
+            if (!slot->writing) {
+                // Only the padding past the end of the file may be missing
+                if (res < 0 || (size_t)res < slot->claimed) {
+                    error = (res < 0) ? -res : EIO;
+                }
+                if (!error) {
+                    slot->writing = true;
+                    slot->op_ns = monotonic_ns();
+                    io_uring_queue_rw(&ring, IORING_OP_WRITE, dst_fd, slot->buffer,
+                                      slot->length, slot->offset, cqe->user_data);
+                    continue;
+                }
+            } else if (res != (int)slot->length) {
+                error = (res < 0) ? -res : EIO;
+            }
+
+            // Slot is idle again, the next round refills it unless we are failing
+            async_slot_finish(slot, block_size, slot->writing && res == (int)slot->length);
+            inflight--;
+        }
+        __atomic_store_n(ring.cq_head, head, __ATOMIC_RELEASE);
+    }
+
+    // An error leaves requests in flight; the kernel may still DMA into their buffers,
+    // so wait for them before the buffer goes back to the shared pool. Entries that
+    // were queued but never submitted are dropped with the ring
+    int submitted = inflight - (int)ring.to_submit;
+    ring.to_submit = 0;
+    while (submitted > 0) {
+        if (io_uring_submit_and_wait(&ring, 1) != 0 && errno != EAGAIN && errno != EBUSY) {
+            break;
+        }
+        unsigned head = *ring.cq_head;
+        unsigned tail = __atomic_load_n(ring.cq_tail, __ATOMIC_ACQUIRE);
+        for (; head != tail; head++) {
+            async_slot_finish(&slots[ring.cqes[head & *ring.cq_mask].user_data], block_size, false);
+            submitted--;
+        }
+        __atomic_store_n(ring.cq_head, head, __ATOMIC_RELEASE);
+    }
+    for (int i = 0; i < queue_depth; i++) {
+        if (slots[i].busy) {
+            async_slot_finish(&slots[i], block_size, false);
+        }
+    }
+
+    // Tear the ring down first so nothing queued on it can still target the buffer
+    io_uring_cleanup(&ring);
+    free_io_buffer(buffer);
+    free(slots);
+    return error ? -1 : 0;
+}
+
+static int io_setup(unsigned nr_events, aio_context_t *ctx) {
+    return syscall(__NR_io_setup, nr_events, ctx);
+}
+
+static int io_destroy(aio_context_t ctx) {
+    return syscall(__NR_io_destroy, ctx);
+}
+
+static int io_submit(aio_context_t ctx, long nr, struct iocb **iocbpp) {
+    return syscall(__NR_io_submit, ctx, nr, iocbpp);
+}
+
+static int io_getevents(aio_context_t ctx, long min_nr, long nr, struct io_event *events) {
+    return syscall(__NR_io_getevents, ctx, min_nr, nr, events, NULL);
+}
+
+static void aio_prep_rw(struct iocb *cb, int opcode, int fd, AsyncSlot *slot, uint64_t slot_index) {
+    memset(cb, 0, sizeof(*cb));
+    cb->aio_lio_opcode = opcode;
+    cb->aio_fildes = fd;
+    cb->aio_buf = (uint64_t)(uintptr_t)slot->buffer;
+    cb->aio_nbytes = slot->length;
+    cb->aio_offset = slot->offset;
+    cb->aio_data = slot_index;
+}
+
+// Linux native AIO copy loop: same slot pipeline as io_uring, via io_submit/io_getevents
+static int libaio_copy_range(int src_fd, int dst_fd, CopyRange *range) {
+    const size_t block_size = g_options.block_size;
+    const int queue_depth = g_options.queue_depth;
+
+    aio_context_t ctx = 0;
+    if (io_setup(queue_depth, &ctx) != 0) {
+        perror("io_setup");
+        return -1;
+    }
+
+    void *buffer = NULL;
+    AsyncSlot *slots = calloc(queue_depth, sizeof(AsyncSlot));
+    struct iocb *iocbs = calloc(queue_depth, sizeof(struct iocb));
+    struct iocb **pending = calloc(queue_depth, sizeof(struct iocb *));
+    struct io_event *events = calloc(queue_depth, sizeof(struct io_event));
+    if (!slots || !iocbs || !pending || !events ||
+        alloc_io_buffer(&buffer, g_options.align, block_size * queue_depth) != 0) {
+        free(slots);
+        free(iocbs);
+        free(pending);
+        free(events);
+        io_destroy(ctx);
+        return -1;
+    }
+
+    int inflight = 0;
+    int num_pending = 0;
+    int error = 0;
+    bool exhausted = false;
+
+    for (int i = 0; i < queue_depth; i++) {
+        slots[i].buffer = (char *)buffer + (size_t)i * block_size;
+    }
+
+    for (;;) {
+        // Start a read on every idle slot the in-flight budget allows
+        for (int i = 0; i < queue_depth && !error && !exhausted; i++) {
+            if (slots[i].busy) {
+                continue;
+            }
+            int started = async_slot_start(&slots[i], range, block_size, inflight == 0);
+            if (started <= 0) {
+                exhausted = (started < 0);
+                break;
+            }
+            aio_prep_rw(&iocbs[i], IOCB_CMD_PREAD, src_fd, &slots[i], i);
+            pending[num_pending++] = &iocbs[i];
+            inflight++;
+        }
+
+        // Submit everything queued since the last round
+        int submitted = 0;
+        while (submitted < num_pending) {
+            int ret = io_submit(ctx, num_pending - submitted, pending + submitted);
+            if (ret < 0 && errno == EINTR) {
+                continue;
+            }
+            if (ret <= 0) {
+                error = (ret < 0) ? errno : EIO;
+                break;
+            }
+            submitted += ret;
+        }
+        // Requests that never reached the kernel will not complete
+        for (int i = submitted; i < num_pending; i++) {
+            async_slot_finish(&slots[pending[i]->aio_data], block_size, false);
+        }
+        inflight -= num_pending - submitted;
+        num_pending = 0;
+        if (inflight == 0) {
+            break;
+        }
+
+        int nr = io_getevents(ctx, 1, queue_depth, events);
+        if (nr < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            error = errno;
+            break;
+        }
+
+        for (int e = 0; e < nr; e++) {
+            uint64_t index = events[e].data;
+            AsyncSlot *slot = &slots[index];
+            long long res = events[e].res;
+            latency_record(slot->writing ? LATENCY_WRITE : LATENCY_READ, slot->op_ns);
+
+            if (!slot->writing) {
+                // Only the padding past the end of the file may be missing
+                if (res < 0 || (size_t)res < slot->claimed) {
+                    error = (res < 0) ? -res : EIO;
+                }
+                if (!error) {
+                    slot->writing = true;
+                    slot->op_ns = monotonic_ns();
+                    aio_prep_rw(&iocbs[index], IOCB_CMD_PWRITE, dst_fd, slot, index);
+                    pending[num_pending++] = &iocbs[index];
+                    continue;
+                }
+            } else if (res != (long long)slot->length) {
+                error = (res < 0) ? -res : EIO;
+            }
+
+            // Slot is idle again, the next round refills it unless we are failing
+            async_slot_finish(slot, block_size, slot->writing && res == (long long)slot->length);
+            inflight--;
+        }
+    }
+
+    // Wait for anything still in flight before the buffers go away
+    while (inflight > 0) {
+        int nr = io_getevents(ctx, 1, queue_depth, events);
+        if (nr < 0 && errno != EINTR) {
+            break;
+        }
+        for (int e = 0; e < nr; e++) {
+            async_slot_finish(&slots[events[e].data], block_size, false);
+        }
+        if (nr > 0) {
+            inflight -= nr;
+        }
+    }
+    for (int i = 0; i < queue_depth; i++) {
+        if (slots[i].busy) {
+            async_slot_finish(&slots[i], block_size, false);
+        }
+    }
+
+    free_io_buffer(buffer);
+    free(slots);
+    free(iocbs);
+    free(pending);
+    free(events);
+    io_destroy(ctx);
+    return error ? -1 : 0;
+}
+
+// In-kernel copy loop: copy_file_range over the range, falling back to sendfile
+// when the filesystem or kernel refuses it. method reports which path was taken.
+static int copy_file_range_copy_range(int src_fd, int dst_fd, CopyRange *range,
+                                      const char **method) {
+    bool use_sendfile = false;
+    bool copied_any = false;
+    uint64_t offset;
+    size_t length;
+    *method = "copy_file_range";
+
+    // Claim in KERNEL_COPY_CLAIM_SIZE pieces so the tail stays splittable
+    while (inflight_acquire(KERNEL_COPY_CLAIM_SIZE, true)) {
+        if (!range_claim(range, KERNEL_COPY_CLAIM_SIZE, &offset, &length)) {
+            inflight_release(KERNEL_COPY_CLAIM_SIZE, 0, 0);
+            break;
+        }
+        loff_t off_in = offset;
+        loff_t off_out = offset;
+        uint64_t end = offset + length;
+        uint64_t issued_ns = monotonic_ns();
+
+        while ((uint64_t)off_in < end) {
+            ssize_t copied;
+            uint64_t call_ns = monotonic_ns();
+            if (!use_sendfile) {
+                copied = copy_file_range(src_fd, &off_in, dst_fd, &off_out, end - off_in, 0);
+                if (copied < 0 && (errno == ENOSYS || errno == EXDEV ||
+                                   errno == EINVAL || errno == EOPNOTSUPP)) {
+                    use_sendfile = true;
+                    *method = copied_any ? "copy_file_range+sendfile" : "sendfile";
+                    continue;
+                }
+            } else {
+                // sendfile writes at the destination file position, move it to the block
+                if (lseek(dst_fd, off_out, SEEK_SET) < 0) {
+                    inflight_release(KERNEL_COPY_CLAIM_SIZE, 0, 0);
+                    return -1;
+                }
+                copied = sendfile(dst_fd, src_fd, &off_in, end - off_in);
+                if (copied > 0) {
+                    off_out += copied;
+                }
+            }
+
+            if (copied < 0 && errno == EINTR) {
+                continue;
+            }
+            if (copied <= 0) {
+                inflight_release(KERNEL_COPY_CLAIM_SIZE, 0, 0);
+                return -1;
+            }
+            latency_record(LATENCY_COPY, call_ns);
+            progress_add(copied);
+            copied_any = copied_any || !use_sendfile;
+        }
+        inflight_release(KERNEL_COPY_CLAIM_SIZE, length, issued_ns);
+    }
+
+    return 0;
+}
+
+// Zero-copy loop: moves pages source -> pipe -> destination with splice(),
+// so the data never passes through a user-space buffer
+static int splice_copy_range(int src_fd, int dst_fd, CopyRange *range) {
+    int pipe_fds[2];
+    if (pipe(pipe_fds) != 0) {
+        return -1;
+    }
+
+    // The kernel may clamp the size (see /proc/sys/fs/pipe-max-size), use what we got
+    if (fcntl(pipe_fds[1], F_SETPIPE_SZ, (int)g_options.pipe_size) < 0) {
+        perror("F_SETPIPE_SZ");
+    }
+    int pipe_size = fcntl(pipe_fds[1], F_GETPIPE_SZ);
+    if (pipe_size <= 0) {
+        pipe_size = 64 * 1024;
+    }
+
+    uint64_t offset;
+    size_t length;
+    int result = 0;
+    while (result == 0 && inflight_acquire(pipe_size, true)) {
+        if (!range_claim(range, pipe_size, &offset, &length)) {
+            inflight_release(pipe_size, 0, 0);
+            break;
+        }
+        loff_t off_in = offset;
+        loff_t off_out = offset;
+        uint64_t end = offset + length;
+        uint64_t issued_ns = monotonic_ns();
+
+        while ((uint64_t)off_in < end) {
+            uint64_t call_ns = monotonic_ns();
+            ssize_t in_pipe = splice(src_fd, &off_in, pipe_fds[1], NULL, end - off_in,
+                                     SPLICE_F_MOVE | SPLICE_F_MORE);
+            if (in_pipe < 0 && errno == EINTR) {
+                continue;
+            }
+            if (in_pipe <= 0) {
+                result = -1;
+                break;
+            }
+            latency_record(LATENCY_READ, call_ns);
+
+            // Drain the pipe completely before refilling it
+            ssize_t left = in_pipe;
+            while (left > 0) {
+                call_ns = monotonic_ns();
+                ssize_t out = splice(pipe_fds[0], NULL, dst_fd, &off_out, left,
+                                     SPLICE_F_MOVE | SPLICE_F_MORE);
+                if (out < 0 && errno == EINTR) {
+                    continue;
+                }
+                if (out <= 0) break;
+                latency_record(LATENCY_WRITE, call_ns);
+                progress_add(out);
+                left -= out;
+            }
+            if (left > 0) {
+                result = -1;
+                break;
+            }
+        }
+        inflight_release(pipe_size, (result == 0) ? length : 0, issued_ns);
+    }
+
+    close(pipe_fds[0]);
+    close(pipe_fds[1]);
+    return result;
+}
+
+// Synchronous O_DIRECT copy of the range with pread/pwrite, used for file chunks
+static int direct_io_copy_range(int src_fd, int dst_fd, CopyRange *range, size_t buffer_size) {
+    void *buffer = NULL;
+    if (alloc_io_buffer(&buffer, g_options.align, buffer_size) != 0) {
+        return -1;
+    }
+
+    uint64_t offset;
+    size_t length;
+    int result = 0;
+    while (inflight_acquire(buffer_size, true)) {
+        if (!range_claim(range, buffer_size, &offset, &length)) {
+            inflight_release(buffer_size, 0, 0);
+            break;
+        }
+
+        // O_DIRECT needs aligned lengths, only the file tail is padded
+        size_t aligned = align_up(length, g_options.align);
+        uint64_t issued_ns = monotonic_ns();
+        bool copied = pread(src_fd, buffer, aligned, offset) >= (ssize_t)length;
+        latency_record(LATENCY_READ, issued_ns);
+        if (copied) {
+            uint64_t write_ns = monotonic_ns();
+            copied = pwrite(dst_fd, buffer, aligned, offset) == (ssize_t)aligned;
+            latency_record(LATENCY_WRITE, write_ns);
+        }
+        if (!copied) {
+            inflight_release(buffer_size, 0, 0);
+            result = -1;
+            break;
+        }
+        inflight_release(buffer_size, length, issued_ns);
+        progress_add(length);
+    }
+
+    free_io_buffer(buffer);
+    return result;
+}
+
+// Engines that can copy an arbitrary byte range of an open file pair
+static bool mode_supports_ranges(CopyMode mode) {
+    switch (mode) {
+        case DIRECT_IO:
+        case IO_URING:
+        case LIBAIO:
+        case COPY_FILE_RANGE:
+        case SPLICE:
+            return true;
+        default:
+            return false;
+    }
+}
+
+static int open_copy_files(CopyMode mode, const char *src, const char *dst,
+                           int *src_fd, int *dst_fd) {
+    int direct = (mode == DIRECT_IO || mode == IO_URING || mode == LIBAIO) ? O_DIRECT : 0;
+
+    *src_fd = open(src, O_RDONLY | direct);
+    if (*src_fd < 0) {
+        return -1;
+    }
+    *dst_fd = open(dst, O_WRONLY | O_CREAT | direct, 0644);
+    if (*dst_fd < 0) {
+        close(*src_fd);
+        return -1;
+    }
+    return 0;
+}
+
+// Copy the range with the engine selected by mode. direct_io runs its reader/writer
+// pipeline when pipelined is set, otherwise a plain pread/pwrite loop.
+static int copy_range(CopyMode mode, int src_fd, int dst_fd, CopyRange *range,
+                      size_t buffer_size, bool pipelined, const char **method) {
+    switch (mode) {
+        case DIRECT_IO:
+            if (pipelined) {
+                return direct_io_pipeline_copy_range(src_fd, dst_fd, range);
+            }
+            return direct_io_copy_range(src_fd, dst_fd, range, buffer_size);
+        case IO_URING:
+            return io_uring_copy_range(src_fd, dst_fd, range);
+        case LIBAIO:
+            return libaio_copy_range(src_fd, dst_fd, range);
+        case COPY_FILE_RANGE:
+            return copy_file_range_copy_range(src_fd, dst_fd, range, method);
+        case SPLICE:
+            return splice_copy_range(src_fd, dst_fd, range);
+        default:
+            return -1;
+    }
+}
+
+// Thread copy function
+void* copy_file_thread(void *arg) {
+    CopyTask *task = (CopyTask *)arg;
+    struct timeval start, end;
+    gettimeofday(&start, NULL);
+
+    struct stat st;
+    stat(task->src_path, &st);
+    task->size_mib = st.st_size / (1024.0 * 1024.0);
+    task->method = NULL;
+
+    int result = -1;
+    switch (task->mode) {
+        case SYSTEM_CP:
+            result = copy_using_cp(task->src_path, task->dst_path);
+            break;
+        case MMAP:
+            result = copy_using_mmap(task->src_path, task->dst_path, st.st_size);
+            break;
+        case DIRECT_IO_MEMORY_IMPACT:
+            result = copy_using_direct_io_memory_impact(task->src_path, task->dst_path, st.st_size);
+            break;
+        default:
+            break;
+    }
+
+    gettimeofday(&end, NULL);
+    task->duration = (end.tv_sec - start.tv_sec) + 
+                    (end.tv_usec - start.tv_usec) / 1000000.0;
+    task->speed = task->size_mib / task->duration;
+    task->result = result;
+
+    return NULL;
+}
+
+// Work-stealing deque: the owning worker takes items from the front in scheduling
+// order, idle workers steal from the back
+typedef struct {
+    pthread_mutex_t lock;
+    void **items;
+    int capacity;
+    int head;
+    int count;
+} WorkDeque;
+
+static void work_deque_init(WorkDeque *dq) {
+    pthread_mutex_init(&dq->lock, NULL);
+    dq->items = NULL;
+    dq->capacity = 0;
+    dq->head = 0;
+    dq->count = 0;
+}
+
+static void work_deque_destroy(WorkDeque *dq) {
+    pthread_mutex_destroy(&dq->lock);
+    free(dq->items);
+}
+
+static void work_deque_push(WorkDeque *dq, void *item) {
+    pthread_mutex_lock(&dq->lock);
+    if (dq->count == dq->capacity) {
+        // Grow and unwrap the ring so head starts at 0 again
+        int capacity = dq->capacity ? dq->capacity * 2 : 16;
+        void **items = malloc(sizeof(void *) * capacity);
+        for (int i = 0; i < dq->count; i++) {
+            items[i] = dq->items[(dq->head + i) % dq->capacity];
+        }
+        free(dq->items);
+        dq->items = items;
+        dq->capacity = capacity;
+        dq->head = 0;
+    }
+    dq->items[(dq->head + dq->count) % dq->capacity] = item;
+    dq->count++;
+    pthread_mutex_unlock(&dq->lock);
+}
+
+static void *work_deque_pop(WorkDeque *dq) {
+    void *item = NULL;
+    pthread_mutex_lock(&dq->lock);
+    if (dq->count > 0) {
+        item = dq->items[dq->head];
+        dq->head = (dq->head + 1) % dq->capacity;
+        dq->count--;
+    }
+    pthread_mutex_unlock(&dq->lock);
+    return item;
+}
+
+static void *work_deque_steal(WorkDeque *dq) {
+    void *item = NULL;
+    pthread_mutex_lock(&dq->lock);
+    if (dq->count > 0) {
+        dq->count--;
+        item = dq->items[(dq->head + dq->count) % dq->capacity];
+    }
+    pthread_mutex_unlock(&dq->lock);
+    return item;
+}
+
+typedef void (*WorkFunction)(void *item, int worker_id);
+
+// Optional straggler hooks: how much work a running item has left, and splitting part
+// of it into a new item for an idle worker (NULL if it cannot be split). Both are
+// called with the pool's running_lock held.
+typedef uint64_t (*RemainingFunction)(void *item);
+typedef void *(*SplitFunction)(void *item, void *ctx);
+
+// Bounded pool of worker threads, each with its own deque
+typedef struct {
+    int num_workers;
+    WorkDeque *deques;
+    WorkFunction fn;
+    int next_deque;  // Round-robin target for worker_pool_submit()
+    RemainingFunction remaining;
+    SplitFunction split;
+    void *split_ctx;
+    pthread_mutex_t running_lock;
+    void **running;  // Item each worker is executing, NULL while idle
+    int *pin_cpus;   // CPU per worker under --pin, worker i uses pin_cpus[i % num_pin_cpus]
+    int num_pin_cpus;
+} WorkerPool;
+
+typedef struct {
+    WorkerPool *pool;
+    int id;
+} PoolWorker;
+
+static void worker_pool_init(WorkerPool *pool, int num_workers, WorkFunction fn) {
+    pool->num_workers = num_workers;
+    pool->deques = malloc(sizeof(WorkDeque) * num_workers);
+    pool->fn = fn;
+    pool->next_deque = 0;
+    pool->remaining = NULL;
+    pool->split = NULL;
+    pool->split_ctx = NULL;
+    pthread_mutex_init(&pool->running_lock, NULL);
+    pool->running = calloc(num_workers, sizeof(void *));
+    pool->num_pin_cpus = build_pin_order(&pool->pin_cpus);
+    for (int i = 0; i < num_workers; i++) {
+        work_deque_init(&pool->deques[i]);
+    }
+}
+
+// Bind a worker to its --pin CPU, or let it float over --cpus
+static void pin_pool_worker(WorkerPool *pool, int worker_id) {
+    cpu_set_t cpus;
+    if (pool->num_pin_cpus > 0) {
+        CPU_ZERO(&cpus);
+        CPU_SET(pool->pin_cpus[worker_id % pool->num_pin_cpus], &cpus);
+    } else if (g_options.has_cpus) {
+        cpus = g_options.cpus;
+    } else {
+        return;
+    }
+    pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+}
+
+// Let idle workers split running items once all queues are empty
+static void worker_pool_set_split(WorkerPool *pool, RemainingFunction remaining,
+                                  SplitFunction split, void *ctx) {
+    pool->remaining = remaining;
+    pool->split = split;
+    pool->split_ctx = ctx;
+}
+
+// Split the running item with the most work left; the new item is marked running
+// for this worker before the lock is dropped so nobody frees it underneath us
+static void *worker_pool_split_straggler(WorkerPool *pool, int worker_id) {
+    void *item = NULL;
+
+    pthread_mutex_lock(&pool->running_lock);
+    void *victim = NULL;
+    uint64_t most_remaining = 0;
+    for (int i = 0; i < pool->num_workers; i++) {
+        if (pool->running[i]) {
+            uint64_t remaining = pool->remaining(pool->running[i]);
+            if (remaining > most_remaining) {
+                most_remaining = remaining;
+                victim = pool->running[i];
+            }
+        }
+    }
+    if (victim) {
+        item = pool->split(victim, pool->split_ctx);
+        pool->running[worker_id] = item;
+    }
+    pthread_mutex_unlock(&pool->running_lock);
+    return item;
+}
+
+// Hand items out round-robin before the pool runs, preserving submission order per worker
+static void worker_pool_submit(WorkerPool *pool, void *item) {
+    work_deque_push(&pool->deques[pool->next_deque], item);
+    pool->next_deque = (pool->next_deque + 1) % pool->num_workers;
+}
+
+static void *pool_worker_thread(void *arg) {
+    PoolWorker *worker = (PoolWorker *)arg;
+    WorkerPool *pool = worker->pool;
+
+    pin_pool_worker(pool, worker->id);
+
+    for (;;) {
+        void *item = work_deque_pop(&pool->deques[worker->id]);
+
+        // Own deque is empty, try to steal from the others
+        for (int i = 1; !item && i < pool->num_workers; i++) {
+            item = work_deque_steal(&pool->deques[(worker->id + i) % pool->num_workers]);
+        }
+
+        if (item) {
+            pthread_mutex_lock(&pool->running_lock);
+            pool->running[worker->id] = item;
+            pthread_mutex_unlock(&pool->running_lock);
+        } else if (pool->split) {
+            // Nothing queued anywhere, help the worker with the most left to do
+            item = worker_pool_split_straggler(pool, worker->id);
+        }
+        if (!item) {
+            break;
+        }
+
+        pool->fn(item, worker->id);
+
+        pthread_mutex_lock(&pool->running_lock);
+        pool->running[worker->id] = NULL;
+        pthread_mutex_unlock(&pool->running_lock);
+    }
+    return NULL;
+}
+
+// Run every submitted item to completion, then release the pool
+static void worker_pool_run(WorkerPool *pool) {
+    pthread_t *threads = malloc(sizeof(pthread_t) * pool->num_workers);
+    PoolWorker *workers = malloc(sizeof(PoolWorker) * pool->num_workers);
+
+    for (int i = 0; i < pool->num_workers; i++) {
+        workers[i].pool = pool;
+        workers[i].id = i;
+        pthread_create(&threads[i], NULL, pool_worker_thread, &workers[i]);
+    }
+    for (int i = 0; i < pool->num_workers; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    for (int i = 0; i < pool->num_workers; i++) {
+        work_deque_destroy(&pool->deques[i]);
+    }
+    pthread_mutex_destroy(&pool->running_lock);
+    free(pool->running);
+    free(pool->deques);
+    free(pool->pin_cpus);
+    free(threads);
+    free(workers);
+}
+
+// Pool size from --threads, by default one worker per CPU but never more than jobs
+static int resolve_worker_count(int num_jobs) {
+    int threads = g_options.threads;
+    if (threads <= 0) {
+        threads = sysconf(_SC_NPROCESSORS_ONLN);
+    }
+    if (threads > num_jobs) {
+        threads = num_jobs;
+    }
+    return (threads > 0) ? threads : 1;
+}
+
+// One unit of work for the copy pool: a whole file, or one offset range of it
+typedef struct {
+    CopyTask *task;
+    uint64_t offset;
+    uint64_t end;
+    CopyRange range;    // Unclaimed part of [offset, end), shrinks when split
+    size_t buffer_size;
+    bool pipelined;     // Whole-file direct_io job, runs the reader/writer pipeline
+    const char *method;
+    uint64_t sort_key;  // Set by the scheduling policy
+} CopyJob;
+
+// Bytes of I/O buffer the job borrows from the pool while it runs, 0 if the engine
+// keeps its data in the kernel
+static size_t copy_job_buffer_size(const CopyJob *job) {
+    switch (job->task->mode) {
+        case DIRECT_IO:
+            return job->pipelined ? job->buffer_size * g_options.direct_io_buffers : job->buffer_size;
+        case DIRECT_IO_MEMORY_IMPACT:
+            return 2 * g_options.read_size;
+        case IO_URING:
+        case LIBAIO:
+            return g_options.block_size * g_options.queue_depth;
+        default:
+            return 0;
+    }
+}
+
+// Jobs created by straggler splits, freed once the pool has finished
+typedef struct {
+    CopyJob **jobs;
+    int count;
+    int capacity;
+} SplitJobList;
+
+// Copy one job on its own descriptors, the last job of a file to finish completes it
+static void copy_chunk_job(CopyJob *job) {
+    CopyTask *task = job->task;
+    int src_fd, dst_fd;
+
+    if (atomic_fetch_add(&task->chunks_started, 1) == 0) {
+        gettimeofday(&task->start, NULL);
+    }
+
+    int result = -1;
+    if (open_copy_files(task->mode, task->src_path, task->dst_path, &src_fd, &dst_fd) == 0) {
+        result = copy_range(task->mode, src_fd, dst_fd, &job->range, job->buffer_size,
+                            job->pipelined, &job->method);
+        close(src_fd);
+        close(dst_fd);
+    }
+    if (result != 0) {
+        range_abandon(&job->range);
+        atomic_store(&task->chunk_failed, true);
+    }
+
+    if (atomic_fetch_sub(&task->chunks_left, 1) != 1) {
+        return;
+    }
+
+    // Drop the padding written past the end of the last block
+    bool failed = atomic_load(&task->chunk_failed);
+    dst_fd = open(task->dst_path, O_WRONLY);
+    if (dst_fd < 0 || ftruncate(dst_fd, task->file_size) != 0) {
+        failed = true;
+    }
+    if (dst_fd >= 0) {
+        close(dst_fd);
+    }
+
+    struct timeval end;
+    gettimeofday(&end, NULL);
+    task->duration = (end.tv_sec - task->start.tv_sec) +
+                    (end.tv_usec - task->start.tv_usec) / 1000000.0;
+    task->speed = task->size_mib / task->duration;
+    task->result = failed ? -1 : 0;
+}
+
+static void run_copy_job(void *item, int worker_id) {
+    CopyJob *job = (CopyJob *)item;
+    t_progress = &g_progress_counters[worker_id % PROGRESS_MAX_WORKERS].bytes;
+
+    // Move to the file's node before any buffer is allocated
+    numa_place_thread(job->task->numa_node);
+
+    int cpu = sched_getcpu();
+    if (cpu >= 0 && cpu < CPU_SETSIZE) {
+        atomic_fetch_or(&job->task->cpus_used[cpu / 64], 1UL << (cpu % 64));
+    }
+
+    if (job->task->num_chunks == 0) {
+        copy_file_thread(job->task);
+    } else {
+        copy_chunk_job(job);
+    }
+}
+
+static uint64_t copy_job_remaining(void *item) {
+    CopyJob *job = (CopyJob *)item;
+    return job->task->num_chunks ? range_remaining(&job->range) : 0;
+}
+
+// Straggler mitigation: hand the unclaimed back half of a running job to an idle worker
+static void *split_copy_job(void *item, void *ctx) {
+    CopyJob *job = (CopyJob *)item;
+    SplitJobList *list = (SplitJobList *)ctx;
+    size_t min_split = (g_options.min_split > g_options.block_size) ?
+                       g_options.min_split : g_options.block_size;
+
+    if (job->task->num_chunks == 0 || g_options.min_split == 0) {
+        return NULL;
+    }
+
+    CopyJob *split = NULL;
+    pthread_mutex_lock(&job->range.lock);
+    uint64_t remaining = job->range.end - job->range.next;
+    if (remaining >= 2 * min_split) {
+        // Keep the split point on a request boundary so O_DIRECT offsets stay aligned
+        uint64_t mid = job->range.next + align_up(remaining / 2, g_options.block_size);
+
+        split = calloc(1, sizeof(CopyJob));
+        split->task = job->task;
+        split->offset = mid;
+        split->end = job->range.end;
+        split->buffer_size = job->buffer_size;
+        split->pipelined = false;
+        range_init(&split->range, mid, job->range.end);
+        job->range.end = mid;
+
+        // Count the new job before the shortened one can finish the file
+        atomic_fetch_add(&job->task->chunks_left, 1);
+        atomic_fetch_add(&job->task->splits, 1);
+    }
+    pthread_mutex_unlock(&job->range.lock);
+
+    if (split) {
+        if (list->count == list->capacity) {
+            list->capacity = list->capacity ? list->capacity * 2 : 16;
+            list->jobs = realloc(list->jobs, sizeof(CopyJob *) * list->capacity);
+        }
+        list->jobs[list->count++] = split;
+    }
+    return split;
+}
+
+// Node a file is copied on under the --numa policy, -1 to leave placement to the scheduler
+static int resolve_numa_node(const CopyTask *task) {
+    int node = -1;
+    switch (g_options.numa) {
+        case NUMA_NONE:
+            return -1;
+        case NUMA_SRC:
+            node = numa_node_of_path(task->src_path);
+            break;
+        case NUMA_DST: {
+            char *dst = strdup(task->dst_path);
+            node = numa_node_of_path(dirname(dst));
+            free(dst);
+            break;
+        }
+        case NUMA_NODE:
+            return g_options.numa_node;
+    }
+
+    // Devices report no locality on single-node machines, where node 0 is exact anyway
+    if (node < 0 && access("/sys/devices/system/node/node1", F_OK) != 0) {
+        node = 0;
+    }
+    return node;
+}
+
+// Plan the pool jobs for one file: chunks_per_file offset ranges with a pre-sized
+// destination for range engines, otherwise one whole-file job.
+// Returns the number of jobs written to jobs.
+static int plan_copy_jobs(CopyTask *task, CopyJob *jobs) {
+    struct stat st;
+    stat(task->src_path, &st);
+    task->file_size = st.st_size;
+
+    // A calibration sample copies [sample_offset, file_size) to the same offsets
+    uint64_t start = 0;
+    if (task->sample_size > 0 && task->sample_size < task->file_size) {
+        start = task->sample_offset;
+        task->file_size = start + task->sample_size;
+    }
+    uint64_t span = task->file_size - start;
+    task->size_mib = span / (1024.0 * 1024.0);
+    task->method = NULL;
+    task->num_chunks = 0;
+    task->numa_node = resolve_numa_node(task);
+    atomic_init(&task->splits, 0);
+    for (int i = 0; i < CPU_SETSIZE / 64; i++) {
+        atomic_init(&task->cpus_used[i], 0);
+    }
+
+    if (!mode_supports_ranges(task->mode)) {
+        memset(&jobs[0], 0, sizeof(CopyJob));
+        jobs[0].task = task;
+        jobs[0].end = task->file_size;
+        return 1;
+    }
+
+    int num_chunks = g_options.chunks_per_file;
+    // Keep chunk boundaries on request boundaries so O_DIRECT offsets stay aligned
+    size_t chunk_size = align_up((span + num_chunks - 1) / num_chunks, g_options.block_size);
+    if (chunk_size > 0) {
+        num_chunks = (span + chunk_size - 1) / chunk_size;
+    }
+
+    if (num_chunks > 1) {
+        // Reserve the whole destination up front, fall back to a sparse file
+        int dst_fd = open(task->dst_path, O_WRONLY | O_CREAT, 0644);
+        if (dst_fd >= 0) {
+            if (fallocate(dst_fd, 0, start, span) != 0 &&
+                ftruncate(dst_fd, task->file_size) != 0) {
+                num_chunks = 1;
+            }
+            close(dst_fd);
+        } else {
+            num_chunks = 1;
+        }
+    }
+    if (num_chunks < 1) {
+        num_chunks = 1;
+    }
+
+    task->num_chunks = num_chunks;
+    atomic_init(&task->chunks_started, 0);
+    atomic_init(&task->chunks_left, num_chunks);
+    atomic_init(&task->chunk_failed, false);
+
+    // The read budget is split across chunks so a file still uses --read-size in total;
+    // a whole direct_io file keeps the pipeline's slot size for any pieces split off it
+    size_t buffer_size = (num_chunks > 1) ?
+                         align_up(g_options.read_size / num_chunks, g_options.align) :
+                         (g_options.read_size / g_options.direct_io_buffers) / g_options.align * g_options.align;
+    for (int i = 0; i < num_chunks; i++) {
+        memset(&jobs[i], 0, sizeof(CopyJob));
+        jobs[i].task = task;
+        jobs[i].offset = start + (uint64_t)i * chunk_size;
+        jobs[i].end = (i == num_chunks - 1) ? task->file_size : start + (uint64_t)(i + 1) * chunk_size;
+        jobs[i].buffer_size = buffer_size;
+        jobs[i].pipelined = (num_chunks == 1);
+    }
+    return num_chunks;
+}
+
+// Physical address of the job's first byte on the source device via FIEMAP,
+// UINT64_MAX when the filesystem cannot tell (such jobs are scheduled last)
+static uint64_t job_physical_offset(const CopyJob *job) {
+    int fd = open(job->task->src_path, O_RDONLY);
+    if (fd < 0) {
+        return UINT64_MAX;
+    }
+
+    char buf[sizeof(struct fiemap) + sizeof(struct fiemap_extent)];
+    struct fiemap *fm = (struct fiemap *)buf;
+    memset(buf, 0, sizeof(buf));
+    fm->fm_start = job->offset;
+    fm->fm_length = (job->end > job->offset) ? job->end - job->offset : 1;
+    fm->fm_extent_count = 1;
+
+    uint64_t physical = UINT64_MAX;
+    if (ioctl(fd, FS_IOC_FIEMAP, fm) == 0 && fm->fm_mapped_extents > 0) {
+        struct fiemap_extent *extent = &fm->fm_extents[0];
+        physical = extent->fe_physical;
+        if (job->offset > extent->fe_logical) {
+            physical += job->offset - extent->fe_logical;
+        }
+    }
+
+    close(fd);
+    return physical;
+}
+
+static int compare_jobs_descending(const void *a, const void *b) {
+    uint64_t ka = ((const CopyJob *)a)->sort_key;
+    uint64_t kb = ((const CopyJob *)b)->sort_key;
+    return (ka < kb) - (ka > kb);
+}
+
+static int compare_jobs_ascending(const void *a, const void *b) {
+    return compare_jobs_descending(b, a);
+}
+
+// Order jobs by the --schedule policy before they are handed out round-robin,
+// so every worker's queue front holds its next job in policy order
+static void schedule_copy_jobs(CopyJob *jobs, int num_jobs) {
+    switch (g_options.schedule) {
+        case SCHEDULE_LPT:
+            for (int i = 0; i < num_jobs; i++) {
+                jobs[i].sort_key = jobs[i].end - jobs[i].offset;
+            }
+            qsort(jobs, num_jobs, sizeof(CopyJob), compare_jobs_descending);
+            break;
+        case SCHEDULE_EXTENT:
+            for (int i = 0; i < num_jobs; i++) {
+                jobs[i].sort_key = job_physical_offset(&jobs[i]);
+            }
+            qsort(jobs, num_jobs, sizeof(CopyJob), compare_jobs_ascending);
+            break;
+        case SCHEDULE_FIFO:
+            break;
+    }
+}
+
+// Copy every task through the worker pool, returns the wall-clock duration
+static double run_copy_tasks(CopyTask *tasks, int num_files) {
+    struct timeval start, end;
+    gettimeofday(&start, NULL);
+
+    int max_jobs = num_files * (g_options.chunks_per_file > 1 ? g_options.chunks_per_file : 1);
+    CopyJob *jobs = malloc(sizeof(CopyJob) * max_jobs);
+    int num_jobs = 0;
+
+    for (int i = 0; i < num_files; i++) {
+        num_jobs += plan_copy_jobs(&tasks[i], &jobs[num_jobs]);
+    }
+    schedule_copy_jobs(jobs, num_jobs);
+
+    // Ranges hold a mutex, so they are only set up once sorting has moved jobs around
+    for (int i = 0; i < num_jobs; i++) {
+        range_init(&jobs[i].range, jobs[i].offset, jobs[i].end);
+    }
+
+    atomic_store(&g_huge_page_fallbacks, 0);
+    latency_reset();
+    g_buffer_pool.peak = g_buffer_pool.owned;
+    g_buffer_pool.allocations = 0;
+    g_buffer_pool.reuses = 0;
+    g_buffer_pool.waits = 0;
+
+    int num_workers = resolve_worker_count(num_jobs);
+    double prefill_seconds = 0;
+    size_t job_buffer_size = (num_jobs > 0) ? copy_job_buffer_size(&jobs[0]) : 0;
+    // Buffers are bound to the node of the workers that will borrow them, so each node
+    // jobs run on gets as many as can be busy there at once. The prefill is not copy time.
+    if (job_buffer_size > 0) {
+        struct timeval prefill_start, prefill_end;
+        size_t page_size = sysconf(_SC_PAGESIZE);
+        size_t alignment = (g_options.align > page_size) ? g_options.align : page_size;
+        // Jobs per node, slot 0 counts unplaced jobs (node -1)
+        int *node_jobs = calloc(NUMA_MAX_NODES + 1, sizeof(int));
+        gettimeofday(&prefill_start, NULL);
+        for (int i = 0; node_jobs && i < num_jobs; i++) {
+            int node = jobs[i].task->numa_node;
+            node_jobs[(node >= -1 && node < NUMA_MAX_NODES) ? node + 1 : 0]++;
+        }
+        for (int slot = 0; node_jobs && slot <= NUMA_MAX_NODES; slot++) {
+            if (node_jobs[slot] > 0) {
+                int count = (num_workers < node_jobs[slot]) ? num_workers : node_jobs[slot];
+                buffer_pool_prefill(count, slot - 1, alignment, job_buffer_size);
+            }
+        }
+        gettimeofday(&prefill_end, NULL);
+        free(node_jobs);
+        prefill_seconds = (prefill_end.tv_sec - prefill_start.tv_sec) +
+                          (prefill_end.tv_usec - prefill_start.tv_usec) / 1000000.0;
+    }
+
+    g_limiter.enabled = g_options.adaptive;
+    g_limiter.max_limit = g_options.max_inflight;
+    if (g_limiter.enabled) {
+        inflight_limiter_start(g_options.block_size);
+    }
+    if (g_progress.enabled) {
+        progress_start();
+    }
+
+    SplitJobList split_jobs = {NULL, 0, 0};
+    WorkerPool pool;
+    worker_pool_init(&pool, num_workers, run_copy_job);
+    worker_pool_set_split(&pool, copy_job_remaining, split_copy_job, &split_jobs);
+    for (int i = 0; i < num_jobs; i++) {
+        worker_pool_submit(&pool, &jobs[i]);
+    }
+    worker_pool_run(&pool);
+    gettimeofday(&end, NULL);
+
+    if (g_limiter.enabled) {
+        inflight_limiter_stop();
+    }
+    if (g_progress.enabled) {
+        progress_stop();
+    }
+
+    // Report a fallback if any piece of the file took one
+    for (int i = 0; i < num_jobs + split_jobs.count; i++) {
+        CopyJob *job = (i < num_jobs) ? &jobs[i] : split_jobs.jobs[i - num_jobs];
+        CopyTask *task = job->task;
+        if (job->method && (!task->method || strcmp(job->method, "copy_file_range") != 0)) {
+            task->method = job->method;
+        }
+    }
+
+    for (int i = 0; i < num_jobs; i++) {
+        range_destroy(&jobs[i].range);
+    }
+    for (int i = 0; i < split_jobs.count; i++) {
+        range_destroy(&split_jobs.jobs[i]->range);
+        free(split_jobs.jobs[i]);
+    }
+    free(split_jobs.jobs);
+    free(jobs);
+    buffer_pool_drain();
+    return (end.tv_sec - start.tv_sec) + (end.tv_usec - start.tv_usec) / 1000000.0 - prefill_seconds;
+}
+
+// Parse file size string
+static uint64_t parse_size(const char *size_str) {
+    uint64_t size;
+    char unit;
+    int matched = sscanf(size_str, "%lu%c", &size, &unit);
+    if (matched == 1) {
+        return size;  // No unit, plain bytes
+    }
+    if (matched != 2) {
+        return 0;
+    }
+    
+    switch (toupper(unit)) {
+        case 'T':
+            size *= 1024;
+        case 'G':
+            size *= 1024;
+        case 'M':
+            size *= 1024 * 1024;
+            break;
+        case 'K':
+            size *= 1024;
+            break;
+        case 'B':
+            break;
+        default:
+            return 0;
+    }
+    
+    return size;
+}
+
+// Parse worker pinning policy, -1 if unknown
+static PinPolicy parse_pin_policy(const char *policy_str) {
+    if (strcmp(policy_str, "none") == 0) return PIN_NONE;
+    if (strcmp(policy_str, "compact") == 0) return PIN_COMPACT;
+    if (strcmp(policy_str, "cores") == 0) return PIN_CORES;
+    if (strcmp(policy_str, "sockets") == 0) return PIN_SOCKETS;
+    return -1;
+}
+
+// Check --cpus and --pin, shared by copy and generate modes. --cpus is narrowed
+// to the CPUs this process may actually run on.
+static bool validate_placement_options(void) {
+    if (g_options.pin == (PinPolicy)-1) {
+        printf("Pin policy must be none, compact, cores or sockets\n");
+        return false;
+    }
+    if (g_options.has_cpus) {
+        cpu_set_t online;
+        if (sched_getaffinity(0, sizeof(online), &online) == 0) {
+            CPU_AND(&g_options.cpus, &g_options.cpus, &online);
+        }
+        if (CPU_COUNT(&g_options.cpus) == 0) {
+            printf("CPU list must name at least one CPU this process can run on\n");
+            return false;
+        }
+    }
+    return true;
+}
+
+// Generate test file
+static int generate_test_file(const char *path, uint64_t size) {
+    int fd;
+    void *buf = NULL;
+    const size_t buf_size = 1024 * 1024; // 1MB buffer
+    uint64_t remaining = size;
+    
+    // Use O_DIRECT for better performance
+    fd = open(path, O_WRONLY | O_CREAT | O_DIRECT, 0644);
+    if (fd < 0) {
+        // If O_DIRECT fails, try without it
+        fd = open(path, O_WRONLY | O_CREAT, 0644);
+        if (fd < 0) {
+            perror("open");
+            return -1;
+        }
+    }
+    
+    // Allocate aligned memory
+    if (posix_memalign(&buf, 512, buf_size)) {
+        close(fd);
+        return -1;
+    }
+    
+    // Replace original random data generation code
+    RandomGenerator gen;
+    init_random_generator(&gen);
+    fill_buffer_with_random_data(&gen, buf, buf_size);
+    
+    // Write to file
+    while (remaining > 0) {
+        size_t to_write = (remaining < buf_size) ? remaining : buf_size;
+        // Ensure write size is multiple of 512 (for O_DIRECT)
+        to_write = (to_write / 512) * 512;
+        
+        ssize_t written = write(fd, buf, to_write);
+        if (written < 0) {
+            perror("write");
+            free(buf);
+            close(fd);
+            return -1;
+        }
+        remaining -= written;
+    }
+    
+    // Cleanup
+    free(buf);
+    if (fsync(fd) < 0) {
+        perror("fsync");
+        close(fd);
+        return -1;
+    }
+    close(fd);
+    return 0;
+}
+
+// Thread function for generating test files
+typedef struct {
+    char *path;
+    uint64_t size;
+    int index;
+    double duration;
+    int result;
+    int cpu;  // CPU the worker generating this file ran on
+} GenerateTask;
+
+void* generate_file_thread(void *arg) {
+    GenerateTask *task = (GenerateTask *)arg;
+    struct timeval start, end;
+    
+    gettimeofday(&start, NULL);
+    int result = generate_test_file(task->path, task->size);
+    gettimeofday(&end, NULL);
+    
+    task->duration = (end.tv_sec - start.tv_sec) + 
+                    (end.tv_usec - start.tv_usec) / 1000000.0;
+    
+    return (void*)(long)result;
+}
+
+static void run_generate_job(void *item, int worker_id) {
+    GenerateTask *task = (GenerateTask *)item;
+    (void)worker_id;
+    task->cpu = sched_getcpu();
+    task->result = (int)(long)generate_file_thread(task);
+}
+
+// New function: handle generate test files mode
+static int handle_generate_test_files(int argc, char *argv[]) {
+    if (argc < 7) {
+        printf("Missing parameters for generate_test_files mode\n");
+        return 1;
+    }
+    
+    uint64_t file_size = 0;
+    int num_files = 0;
+    char *output_dir = ".";  // Default to current directory
+    
+    // Parse arguments
+    for (int i = 3; i < argc; i += 2) {
+        if (strcmp(argv[i], "--size") == 0) {
+            file_size = parse_size(argv[i+1]);
+        } else if (strcmp(argv[i], "--num") == 0) {
+            num_files = atoi(argv[i+1]);
+        } else if (strcmp(argv[i], "--dir") == 0) {
+            output_dir = argv[i+1];
+        } else if (strcmp(argv[i], "--threads") == 0) {
+            g_options.threads = atoi(argv[i+1]);
+        } else if (strcmp(argv[i], "--cpus") == 0) {
+            g_options.has_cpus = true;
+            parse_cpu_list(argv[i+1], &g_options.cpus);
+        } else if (strcmp(argv[i], "--pin") == 0) {
+            g_options.pin = parse_pin_policy(argv[i+1]);
+        }
+    }
+    
+    if (file_size == 0 || num_files <= 0) {
+        printf("Invalid size or number of files\n");
+        return 1;
+    }
+    if (!validate_placement_options()) {
+        return 1;
+    }
+    
+    // Create and execute generation tasks
+    GenerateTask *tasks = malloc(sizeof(GenerateTask) * num_files);
+    WorkerPool pool;
+    worker_pool_init(&pool, resolve_worker_count(num_files), run_generate_job);
+    
+    printf("Generating %d test files of size %luB each in %s\n", 
+           num_files, file_size, output_dir);
+    
+    for (int i = 0; i < num_files; i++) {
+        tasks[i].path = malloc(strlen(output_dir) + 32);
+        sprintf(tasks[i].path, "%s/test_file_%d", output_dir, i + 1);
+        tasks[i].size = file_size;
+        tasks[i].index = i;
+        
+        worker_pool_submit(&pool, &tasks[i]);
+    }
+    
+    // Wait for all workers to complete
+    struct timeval start, end;
+    gettimeofday(&start, NULL);
+    worker_pool_run(&pool);
+    gettimeofday(&end, NULL);
+    bool all_success = true;
+    for (int i = 0; i < num_files; i++) {
+        if (tasks[i].result != 0) {
+            all_success = false;
+        }
+    }
+    
+    // Print results
+    printf("\nGeneration Results:\n");
+    bool show_cpu = (g_options.pin != PIN_NONE || g_options.has_cpus);
+    printf("%-10s %-30s %-15s %-12s%s\n", 
+           "File #", "Path", "Size", "Duration (s)", show_cpu ? "  CPU" : "");
+    printf("------------------------------------------------------------\n");
+    
+    // Files queue for workers, so the total is wall-clock time rather than the slowest file
+    double total_duration = (end.tv_sec - start.tv_sec) + (end.tv_usec - start.tv_usec) / 1000000.0;
+    for (int i = 0; i < num_files; i++) {
+        printf("%-10d %-30s %-15lu %11.2f",
+               i + 1, tasks[i].path, file_size, tasks[i].duration);
+        if (show_cpu) {
+            printf("  %4d", tasks[i].cpu);
+        }
+        printf("\n");
+    }
+    
+    printf("\nTotal Statistics:\n");
+    printf("Total Size: %.2f GiB\n", 
+           (file_size * num_files) / (1024.0 * 1024.0 * 1024.0));
+    printf("Total Duration: %.2f seconds\n", total_duration);
+    printf("Average Speed: %.2f MiB/s\n", 
+           (file_size * num_files) / (1024.0 * 1024.0) / total_duration);
+    
+    // Cleanup resources
+    for (int i = 0; i < num_files; i++) {
+        free(tasks[i].path);
+    }
+    free(tasks);
+    
+    return all_success ? 0 : 1;
+}
+
+// Print usage information
+static void print_usage(const char *program_name) {
+    printf("Usage:\n");
+    printf("  Copy files:\n");
+    printf("    %s --mode [cp|mmap|direct_io|direct_io_memory_impact|io_uring|libaio|copy_file_range|splice] [options] --from file1 [file2 ...] --to dest_dir\n", program_name);
+    printf("  Copy options:\n");
+    printf("    --block-size <size>[K|M|G]   I/O size per request for io_uring/libaio (default 1M)\n");
+    printf("    --queue-depth <number>       Requests in flight per file for io_uring/libaio (default %d)\n", DEFAULT_QUEUE_DEPTH);
+    printf("    --pipe-size <size>[K|M]      Pipe buffer size for splice (default 1M)\n");
+    printf("    --buffers <number>           Ring buffers between direct_io reader and writer (default %d)\n",
+           DEFAULT_DIRECT_IO_BUFFERS);
+    printf("    --chunks-per-file <number>   Copy each file as N concurrent offset ranges (default %d)\n",
+           DEFAULT_CHUNKS_PER_FILE);
+    printf("    --threads <number>           Worker threads shared by all files (default: one per CPU)\n");
+    printf("    --schedule [fifo|lpt|extent] Job order: command line, largest first, or source extent order\n");
+    printf("    --min-split <size>[K|M|G]    Smallest range idle workers split off a straggler, 0 disables (default 64M)\n");
+    printf("    --align <size>               O_DIRECT buffer and offset alignment (default %d)\n", BLOCK_SIZE);
+    printf("    --read-size <size>[K|M|G]    Read budget per file for direct_io and direct_io_memory_impact (default 1G)\n");
+    printf("    --mmap-chunk <size>[K|M|G]   Mapping window for mmap (default 512M)\n");
+    printf("    --dma-block <size>[K|M]      memcpy size per simulated DMA transfer (default 2M)\n");
+    printf("    --autotune                   Hill-climb threads, block size and queue depth on sample copies first\n");
+    printf("    --autotune-sample <size>     Bytes copied per calibration trial (default 64M)\n");
+    printf("    --adaptive                   Size the pool-wide in-flight bytes with AIMD on throughput and latency\n");
+    printf("    --max-inflight <size>        Upper bound for --adaptive (default 1G)\n");
+    printf("    --numa [none|src|dst|<node>] Pin workers and allocate buffers on the source/destination device's node\n");
+    printf("    --cpus <list>                Run workers only on these CPUs, e.g. 0-3,8\n");
+    printf("    --pin [none|compact|cores|sockets]  Bind each worker to one CPU, packed or spread over cores/sockets\n");
+    printf("    --huge-pages [none|thp|2M|1G] Back copy buffers with huge pages, 2M/1G fall back to THP if none are reserved\n");
+    printf("    --copy-kernel <kernel>       memcpy for mmap and direct_io_memory_impact: auto, libc, prefetch,\n"
+           "                                 rep_movsb, avx2_nt, avx512_nt (default auto: widest streaming kernel)\n");
+    printf("    --buffer-budget <size>       Memory the shared buffer pool may hold, workers wait beyond it (default unlimited)\n");
+    printf("    --progress <seconds>         Print throughput, bytes done and ETA every interval while copying\n");
+    printf("    --progress-log <file>        Also write the progress samples as CSV (interval defaults to 1s)\n");
+    printf("  Sweep:\n");
+    printf("    %s --mode sweep --engine <copy mode> [--block-sizes 64K,1M,...] [--threads-list 1,2,...]\n"
+           "        [--queue-depths 1,8,...] [copy options] --from file1 [file2 ...] --to dest_dir\n", program_name);
+    printf("  Memory bandwidth:\n");
+    printf("    %s --mode memory_bandwidth [--size <size>] [--threads-list 1,2,...] [--repeat <n>]\n"
+           "        [--cpus <list>] [--pin <policy>] [--numa <node>] [--huge-pages <policy>]\n", program_name);
+    printf("  memcpy kernels:\n");
+    printf("    %s --mode memcpy_bench [--sizes 64B,4K,1M,...] [--offsets 0,1,...] [--cpus <list>] [--pin <policy>]\n",
+           program_name);
+    printf("  Cache hierarchy:\n");
+    printf("    %s --mode cache_sweep [--sizes 4K,32K,...] [--threads <number>] [--copy-kernel <kernel>]\n"
+           "        [--cpus <list>] [--pin <policy>] [--numa <node>] [--huge-pages <policy>]\n", program_name);
+    printf("  NUMA bandwidth matrix:\n");
+    printf("    %s --mode numa_matrix [--size <size>] [--repeat <n>] [--threads <number>] [--dma-block <size>]\n"
+           "        [--copy-kernel <kernel>] [--huge-pages <policy>]\n", program_name);
+    printf("  Disk and memory contention:\n");
+    printf("    %s --mode contention [--engine <copy mode>] [--memory-threads <n>] [--size <size>]\n"
+           "        [copy options] --from file1 [file2 ...] --to dest_dir\n", program_name);
+    printf("  Generate test files:\n");
+    printf("    %s --mode generate_test_files --size <size>[M|G|T] --num <number> [--dir <output_dir>] [--threads <number>]\n"
+           "        [--cpus <list>] [--pin [none|compact|cores|sockets]]\n", program_name);
+    printf("  Benchmark:\n");
+    printf("    %s --mode benchmark --size <size>[M|G|T] --num <number> [copy options] --from <source_dir> --to <dest_dir>\n", program_name);
+}
+
+// Parse copy mode from command line argument
+static CopyMode parse_copy_mode(const char *mode_str) {
+    if (strcmp(mode_str, "cp") == 0) return SYSTEM_CP;
+    if (strcmp(mode_str, "mmap") == 0) return MMAP;
+    if (strcmp(mode_str, "direct_io") == 0) return DIRECT_IO;
+    if (strcmp(mode_str, "direct_io_memory_impact") == 0) return DIRECT_IO_MEMORY_IMPACT;
+    if (strcmp(mode_str, "io_uring") == 0) return IO_URING;
+    if (strcmp(mode_str, "libaio") == 0) return LIBAIO;
+    if (strcmp(mode_str, "copy_file_range") == 0) return COPY_FILE_RANGE;
+    if (strcmp(mode_str, "splice") == 0) return SPLICE;
+    return -1;
+}
+
+// Print the merged per-call latency percentiles of every operation the engine made
+static void print_latency_results(void) {
+    LatencyHistogram *merged = malloc(sizeof(LatencyHistogram));
+    if (!merged) {
+        return;
+    }
+    latency_merge(merged);
+
+    bool header = false;
+    const double percentiles[] = {50, 90, 99, 99.9};
+    for (int op = 0; op < NUM_LATENCY_OPS; op++) {
+        if (merged->total[op] == 0) {
+            continue;
+        }
+        if (!header) {
+            printf("\nI/O Latency (us):\n");
+            printf("%-8s %12s %10s %10s %10s %10s %10s\n", "Call", "Count", "p50", "p90", "p99", "p99.9", "Max");
+            header = true;
+        }
+        printf("%-8s %12llu", latency_op_names[op], (unsigned long long)merged->total[op]);
+        for (int p = 0; p < 4; p++) {
+            printf(" %10.1f", latency_percentile(merged, op, percentiles[p]) / 1000.0);
+        }
+        printf(" %10.1f\n", merged->max[op] / 1000.0);
+    }
+    free(merged);
+}
+
+// Print copy results, files share a worker pool so the total is wall-clock time
+static void print_copy_results(CopyTask *tasks, int num_files, double total_duration) {
+    // Only show the method column when an engine reported one
+    bool show_method = false;
+    for (int i = 0; i < num_files; i++) {
+        if (tasks[i].method) {
+            show_method = true;
+        }
+    }
+    bool show_node = (g_options.numa != NUMA_NONE);
+    bool show_cpus = (g_options.pin != PIN_NONE || g_options.has_cpus);
+
+    printf("\nDetailed Results:\n");
+    printf("%-10s %-30s %-12s %-12s %-12s%s%s%s\n", 
+           "Thread ID", "Filename", "Size (MiB)", "Duration (s)", "Speed (MiB/s)",
+           show_node ? "  Node" : "", show_cpus ? (show_method ? "  CPUs      " : "  CPUs") : "", show_method ? "  Method" : "");
+    printf("--------------------------------------------------------------------------------\n");
+
+    double total_size = 0;
+    int total_splits = 0;
+    for (int i = 0; i < num_files; i++) {
+        printf("%-10d %-30s %11.2f %11.2f %11.2f", 
+               i, basename(tasks[i].src_path), 
+               tasks[i].size_mib, tasks[i].duration, tasks[i].speed);
+        if (show_node) {
+            if (tasks[i].numa_node >= 0) {
+                printf("  %4d", tasks[i].numa_node);
+            } else {
+                printf("  %4s", "-");
+            }
+        }
+        if (show_cpus) {
+            cpu_set_t used;
+            char list[256];
+            CPU_ZERO(&used);
+            for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+                if (atomic_load(&tasks[i].cpus_used[cpu / 64]) & (1UL << (cpu % 64))) {
+                    CPU_SET(cpu, &used);
+                }
+            }
+            format_cpu_list(&used, list, sizeof(list));
+            printf(show_method ? "  %-10s" : "  %s", list);
+        }
+        if (show_method) {
+            printf("   %s", tasks[i].method ? tasks[i].method : "-");
+        }
+        printf("\n");
+        total_size += tasks[i].size_mib;
+        total_splits += atomic_load(&tasks[i].splits);
+    }
+
+    printf("\nTotal Statistics:\n");
+    printf("Total Size: %.2f MiB\n", total_size);
+    printf("Total Duration: %.2f seconds\n", total_duration);
+    printf("Average Speed: %.2f MiB/s\n", total_size / total_duration);
+    if (total_splits > 0) {
+        printf("Straggler Splits: %d\n", total_splits);
+    }
+    if (g_options.huge_pages != HUGE_PAGES_NONE) {
+        const char *names[] = {"none", "THP", "2M", "1G"};
+        int fallbacks = atomic_load(&g_huge_page_fallbacks);
+        printf("Huge Pages: %s", names[g_options.huge_pages]);
+        if (fallbacks > 0) {
+            printf(" (%d buffers fell back to THP, reserve more in /sys/kernel/mm/hugepages)", fallbacks);
+        }
+        printf("\n");
+    }
+    if (num_files > 0 && (tasks[0].mode == MMAP || tasks[0].mode == DIRECT_IO_MEMORY_IMPACT)) {
+        printf("Copy Kernel: %s\n", copy_kernels[resolve_copy_kernel(g_options.copy_kernel)].name);
+    }
+    if (g_buffer_pool.allocations + g_buffer_pool.reuses > 0) {
+        printf("Buffer Pool: %d allocations, %d reuses, peak %.2f MiB",
+               g_buffer_pool.allocations, g_buffer_pool.reuses, g_buffer_pool.peak / (1024.0 * 1024.0));
+        if (g_buffer_pool.waits > 0) {
+            printf(", %d waits for the budget", g_buffer_pool.waits);
+        }
+        printf("\n");
+    }
+    print_latency_results();
+    if (g_limiter.enabled) {
+        printf("Adaptive In-flight: final %.2f MiB, peak %.2f MiB, %d backoffs\n",
+               g_limiter.limit / (1024.0 * 1024.0), g_limiter.peak_limit / (1024.0 * 1024.0),
+               g_limiter.backoffs);
+    }
+}
+
+// Parse huge page policy, -1 if unknown
+static HugePagePolicy parse_huge_page_policy(const char *policy_str) {
+    if (strcmp(policy_str, "none") == 0) return HUGE_PAGES_NONE;
+    if (strcmp(policy_str, "thp") == 0) return HUGE_PAGES_THP;
+    if (strcmp(policy_str, "2M") == 0 || strcmp(policy_str, "2m") == 0) return HUGE_PAGES_2M;
+    if (strcmp(policy_str, "1G") == 0 || strcmp(policy_str, "1g") == 0) return HUGE_PAGES_1G;
+    return -1;
+}
+
+// Parse copy kernel name, -1 if unknown
+static CopyKernel parse_copy_kernel(const char *kernel_str) {
+    for (int k = 0; k < NUM_COPY_KERNELS; k++) {
+        if (strcmp(kernel_str, copy_kernels[k].name) == 0) {
+            return k;
+        }
+    }
+    return -1;
+}
+
+// Parse scheduling policy, -1 if unknown
+static SchedulePolicy parse_schedule_policy(const char *policy_str) {
+    if (strcmp(policy_str, "fifo") == 0) return SCHEDULE_FIFO;
+    if (strcmp(policy_str, "lpt") == 0) return SCHEDULE_LPT;
+    if (strcmp(policy_str, "extent") == 0) return SCHEDULE_EXTENT;
+    return -1;
+}
+
+// Parse engine tuning options, returns true if argv[*i] was consumed
+static bool parse_copy_option(int argc, char *argv[], int *i) {
+    if (strcmp(argv[*i], "--autotune") == 0) {
+        g_options.autotune = true;
+        return true;
+    }
+    if (strcmp(argv[*i], "--adaptive") == 0) {
+        g_options.adaptive = true;
+        return true;
+    }
+    if (*i + 1 >= argc) {
+        return false;
+    }
+
+    if (strcmp(argv[*i], "--block-size") == 0) {
+        g_options.block_size = parse_size(argv[++(*i)]);
+        return true;
+    }
+    if (strcmp(argv[*i], "--queue-depth") == 0) {
+        g_options.queue_depth = atoi(argv[++(*i)]);
+        return true;
+    }
+    if (strcmp(argv[*i], "--pipe-size") == 0) {
+        g_options.pipe_size = parse_size(argv[++(*i)]);
+        return true;
+    }
+    if (strcmp(argv[*i], "--buffers") == 0) {
+        g_options.direct_io_buffers = atoi(argv[++(*i)]);
+        return true;
+    }
+    if (strcmp(argv[*i], "--chunks-per-file") == 0) {
+        g_options.chunks_per_file = atoi(argv[++(*i)]);
+        return true;
+    }
+    if (strcmp(argv[*i], "--threads") == 0) {
+        g_options.threads = atoi(argv[++(*i)]);
+        return true;
+    }
+    if (strcmp(argv[*i], "--min-split") == 0) {
+        g_options.min_split = parse_size(argv[++(*i)]);
+        return true;
+    }
+    if (strcmp(argv[*i], "--schedule") == 0) {
+        g_options.schedule = parse_schedule_policy(argv[++(*i)]);
+        return true;
+    }
+    if (strcmp(argv[*i], "--align") == 0) {
+        g_options.align = parse_size(argv[++(*i)]);
+        return true;
+    }
+    if (strcmp(argv[*i], "--read-size") == 0) {
+        g_options.read_size = parse_size(argv[++(*i)]);
+        return true;
+    }
+    if (strcmp(argv[*i], "--mmap-chunk") == 0) {
+        g_options.mmap_chunk_size = parse_size(argv[++(*i)]);
+        return true;
+    }
+    if (strcmp(argv[*i], "--dma-block") == 0) {
+        g_options.dma_block_size = parse_size(argv[++(*i)]);
+        return true;
+    }
+    if (strcmp(argv[*i], "--autotune-sample") == 0) {
+        g_options.autotune_sample = parse_size(argv[++(*i)]);
+        return true;
+    }
+    if (strcmp(argv[*i], "--numa") == 0) {
+        const char *policy = argv[++(*i)];
+        if (strcmp(policy, "none") == 0) {
+            g_options.numa = NUMA_NONE;
+        } else if (strcmp(policy, "src") == 0) {
+            g_options.numa = NUMA_SRC;
+        } else if (strcmp(policy, "dst") == 0) {
+            g_options.numa = NUMA_DST;
+        } else {
+            g_options.numa = NUMA_NODE;
+            g_options.numa_node = isdigit((unsigned char)policy[0]) ? atoi(policy) : -1;
+        }
+        return true;
+    }
+    if (strcmp(argv[*i], "--cpus") == 0) {
+        g_options.has_cpus = true;
+        parse_cpu_list(argv[++(*i)], &g_options.cpus);
+        return true;
+    }
+    if (strcmp(argv[*i], "--pin") == 0) {
+        g_options.pin = parse_pin_policy(argv[++(*i)]);
+        return true;
+    }
+    if (strcmp(argv[*i], "--huge-pages") == 0) {
+        g_options.huge_pages = parse_huge_page_policy(argv[++(*i)]);
+        return true;
+    }
+    if (strcmp(argv[*i], "--max-inflight") == 0) {
+        g_options.max_inflight = parse_size(argv[++(*i)]);
+        return true;
+    }
+    if (strcmp(argv[*i], "--copy-kernel") == 0) {
+        g_options.copy_kernel = parse_copy_kernel(argv[++(*i)]);
+        return true;
+    }
+    if (strcmp(argv[*i], "--progress") == 0) {
+        g_options.progress_interval = atof(argv[++(*i)]);
+        return true;
+    }
+    if (strcmp(argv[*i], "--progress-log") == 0) {
+        g_options.progress_log = argv[++(*i)];
+        return true;
+    }
+    if (strcmp(argv[*i], "--buffer-budget") == 0) {
+        g_options.buffer_budget = parse_size(argv[++(*i)]);
+        return true;
+    }
+    return false;
+}
+
+// Check g_options for values the engines cannot work with, prints the first problem found
+static bool validate_copy_options(void) {
+    size_t page_size = sysconf(_SC_PAGESIZE);
+
+    if (g_options.align < 512 || (g_options.align & (g_options.align - 1)) != 0) {
+        printf("Alignment must be a power of two of at least 512\n");
+        return false;
+    }
+    if (g_options.block_size == 0 || g_options.block_size % g_options.align != 0) {
+        printf("Block size must be a multiple of the alignment (%zu)\n", g_options.align);
+        return false;
+    }
+    if (g_options.direct_io_buffers < 2) {
+        printf("direct_io needs at least 2 buffers\n");
+        return false;
+    }
+    if (g_options.read_size % page_size != 0 ||
+        g_options.read_size < g_options.align * g_options.direct_io_buffers) {
+        printf("Read size must be a multiple of the page size and hold one aligned block per buffer\n");
+        return false;
+    }
+    if (g_options.mmap_chunk_size == 0 || g_options.mmap_chunk_size % page_size != 0) {
+        printf("mmap chunk size must be a multiple of the page size (%zu)\n", page_size);
+        return false;
+    }
+    if (g_options.dma_block_size == 0) {
+        printf("DMA block size must be positive\n");
+        return false;
+    }
+    if (g_options.queue_depth <= 0 || g_options.pipe_size == 0 || g_options.chunks_per_file <= 0 ||
+        g_options.threads < 0) {
+        printf("Queue depth, pipe size and chunks must be positive\n");
+        return false;
+    }
+    if (g_options.schedule == (SchedulePolicy)-1) {
+        printf("Schedule must be fifo, lpt or extent\n");
+        return false;
+    }
+    if (g_options.progress_interval < 0) {
+        printf("Progress interval must not be negative\n");
+        return false;
+    }
+    if (g_options.progress_log && g_options.progress_interval == 0) {
+        g_options.progress_interval = 1.0;
+    }
+    if (g_options.autotune && g_options.autotune_sample == 0) {
+        printf("Autotune sample size must be positive\n");
+        return false;
+    }
+    if (!validate_placement_options()) {
+        return false;
+    }
+    if (g_options.huge_pages == (HugePagePolicy)-1) {
+        printf("Huge page policy must be none, thp, 2M or 1G\n");
+        return false;
+    }
+    CopyKernel kernel = resolve_copy_kernel(g_options.copy_kernel);
+    if (!copy_kernel_available(kernel)) {
+        printf("Copy kernel must be auto, libc, prefetch, rep_movsb, avx2_nt or avx512_nt and supported by this CPU\n");
+        return false;
+    }
+    g_copy_function = copy_kernels[kernel].fn;
+    if (g_options.numa == NUMA_NODE) {
+        char node_dir[64];
+        snprintf(node_dir, sizeof(node_dir), "/sys/devices/system/node/node%d", g_options.numa_node);
+        if (g_options.numa_node < 0 || g_options.numa_node >= NUMA_MAX_NODES || access(node_dir, F_OK) != 0) {
+            printf("NUMA policy must be none, src, dst or an online node number\n");
+            return false;
+        }
+    }
+    if (g_options.adaptive && g_options.max_inflight < g_options.block_size) {
+        printf("Max in-flight bytes must be at least one block\n");
+        return false;
+    }
+    return true;
+}
+
+// Add benchmark result structure
+typedef struct {
+    char *filename;
+    double size_mib;
+    double memory_duration;
+    double memory_speed;
+    double disk_duration;
+    double disk_speed;
+} BenchmarkResult;
+
+// Run every file through run_copy_tasks() in mode, returns the wall-clock duration
+// and fills in the per-file results
+static double run_benchmark_phase(CopyMode mode, GenerateTask *files, int num_files,
+                                  const char *to_dir, const char *suffix, CopyTask *tasks) {
+    for (int i = 0; i < num_files; i++) {
+        memset(&tasks[i], 0, sizeof(CopyTask));
+        tasks[i].src_path = files[i].path;
+        tasks[i].dst_path = malloc(strlen(to_dir) + 48);
+        sprintf(tasks[i].dst_path, "%s/test_file_%d%s", to_dir, i + 1, suffix);
+        tasks[i].mode = mode;
+    }
+
+    double duration = run_copy_tasks(tasks, num_files);
+
+    for (int i = 0; i < num_files; i++) {
+        free(tasks[i].dst_path);
+    }
+    return duration;
+}
+
+// New function to handle benchmark mode
+static int handle_benchmark(int argc, char *argv[]) {
+    uint64_t file_size = 0;
+    int num_files = 0;
+    char *from_dir = NULL;
+    char *to_dir = NULL;
+    
+    // Parse arguments
+    for (int i = 3; i < argc; i++) {
+        if (strcmp(argv[i], "--size") == 0 && i + 1 < argc) {
+            file_size = parse_size(argv[++i]);
+        } else if (strcmp(argv[i], "--num") == 0 && i + 1 < argc) {
+            num_files = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--from") == 0 && i + 1 < argc) {
+            from_dir = argv[++i];
+        } else if (strcmp(argv[i], "--to") == 0 && i + 1 < argc) {
+            to_dir = argv[++i];
+        } else if (!parse_copy_option(argc, argv, &i)) {
+            printf("Unknown option: %s\n", argv[i]);
+            return 1;
+        }
+    }
+    
+    if (file_size == 0 || num_files <= 0 || !from_dir || !to_dir) {
+        printf("Invalid parameters for benchmark mode\n");
+        return 1;
+    }
+    if (!validate_copy_options()) {
+        return 1;
+    }
+
+    // Generate test files first
+    printf("Generating test files...\n");
+    GenerateTask *gen_tasks = malloc(sizeof(GenerateTask) * num_files);
+    WorkerPool gen_pool;
+    worker_pool_init(&gen_pool, resolve_worker_count(num_files), run_generate_job);
+    
+    for (int i = 0; i < num_files; i++) {
+        gen_tasks[i].path = malloc(strlen(from_dir) + 32);
+        sprintf(gen_tasks[i].path, "%s/test_file_%d", from_dir, i + 1);
+        gen_tasks[i].size = file_size;
+        gen_tasks[i].index = i;
+        worker_pool_submit(&gen_pool, &gen_tasks[i]);
+    }
+    worker_pool_run(&gen_pool);
+
+    // Prepare benchmark results array
+    BenchmarkResult *results = malloc(sizeof(BenchmarkResult) * num_files);
+    CopyTask *tasks = malloc(sizeof(CopyTask) * num_files);
+    
+    // Both phases run the files concurrently on the copy worker pool, so the
+    // durations are wall-clock times of the whole phase
+    printf("\nRunning memory copy tests...\n");
+    double total_memory_duration = run_benchmark_phase(DIRECT_IO_MEMORY_IMPACT, gen_tasks, num_files,
+                                                       to_dir, "", tasks);
+    for (int i = 0; i < num_files; i++) {
+        results[i].filename = strdup(basename(tasks[i].src_path));
+        results[i].size_mib = tasks[i].size_mib;
+        results[i].memory_duration = tasks[i].duration;
+        results[i].memory_speed = tasks[i].speed;
+    }
+
+    // Run disk copy tests using direct_io mode
+    printf("\nRunning disk copy tests...\n");
+    double total_disk_duration = run_benchmark_phase(DIRECT_IO, gen_tasks, num_files,
+                                                     to_dir, "_disk", tasks);
+    for (int i = 0; i < num_files; i++) {
+        results[i].disk_duration = tasks[i].duration;
+        results[i].disk_speed = tasks[i].speed;
+    }
+    free(tasks);
+
+    // Calculate total statistics
+    double total_size = 0;
+    for (int i = 0; i < num_files; i++) {
+        total_size += results[i].size_mib;
+    }
+    double avg_memory_speed = total_size / total_memory_duration;
+    double avg_disk_speed = total_size / total_disk_duration;
+
+    // Print results
+    printf("\nBenchmark Results:\n");
+    printf("%-10s %-20s %-12s %-20s %-20s %-20s %-20s\n",
+           "Thread ID", "Filename", "Size (MiB)",
+           "Memory Copy (s)", "Memory Speed (MiB/s)",
+           "Disk Copy (s)", "Disk Speed (MiB/s)");
+    printf("--------------------------------------------------------------------------------------------------------\n");
+
+    for (int i = 0; i < num_files; i++) {
+        printf("%-10d %-20s %11.2f %19.2f %19.2f %19.2f %19.2f\n",
+               i, results[i].filename, results[i].size_mib,
+               results[i].memory_duration, results[i].memory_speed,
+               results[i].disk_duration, results[i].disk_speed);
+    }
+
+    printf("\nTotal Statistics:\n");
+    printf("Total Size: %.2f MiB\n", total_size);
+    printf("Memory Copy - Total Duration: %.2f seconds, Average Speed: %.2f MiB/s\n",
+           total_memory_duration, avg_memory_speed);
+    printf("Disk Copy   - Total Duration: %.2f seconds, Average Speed: %.2f MiB/s\n",
+           total_disk_duration, avg_disk_speed);
+
+    double speed_ratio = avg_disk_speed / avg_memory_speed;
+    if (speed_ratio >= 0.95) {
+        printf("\033[41m\033[37mYou may hit the memory bandwidth wall\033[0m\n");
+    }
+
+    // Cleanup
+    for (int i = 0; i < num_files; i++) {
+        free(gen_tasks[i].path);
+        free(results[i].filename);
+    }
+    free(gen_tasks);
+    free(results);
+
+    return 0;
+}
+
+#define MAX_SWEEP_VALUES 16
+
+// Parse a comma separated list such as "64K,1M,4M", sizes take K/M/G suffixes
+static int parse_value_list(const char *list, uint64_t *values, bool sizes) {
+    char *copy = strdup(list);
+    char *save = NULL;
+    int count = 0;
+
+    for (char *token = strtok_r(copy, ",", &save); token; token = strtok_r(NULL, ",", &save)) {
+        uint64_t value = sizes ? parse_size(token) : (uint64_t)atoi(token);
+        if (count == MAX_SWEEP_VALUES || value == 0) {
+            count = -1;
+            break;
+        }
+        values[count++] = value;
+    }
+
+    free(copy);
+    return count;
+}
+
+// Format a byte count the way it is typed on the command line (64K, 1M, ...)
+static void format_size(uint64_t bytes, char *out, size_t out_size) {
+    if (bytes % (1024ULL * 1024 * 1024) == 0) {
+        snprintf(out, out_size, "%lluG", (unsigned long long)(bytes >> 30));
+    } else if (bytes % (1024 * 1024) == 0) {
+        snprintf(out, out_size, "%lluM", (unsigned long long)(bytes >> 20));
+    } else if (bytes % 1024 == 0) {
+        snprintf(out, out_size, "%lluK", (unsigned long long)(bytes >> 10));
+    } else {
+        snprintf(out, out_size, "%llu", (unsigned long long)bytes);
+    }
+}
+
+// Map a block size (sweep or autotune axis) onto the knob each engine actually uses, false if it has none
+static bool apply_block_size_knob(CopyMode mode, uint64_t size) {
+    switch (mode) {
+        case IO_URING:
+        case LIBAIO:
+            g_options.block_size = size;
+            return true;
+        case DIRECT_IO:
+            // Ring slots are read_size / buffers, so scale the budget to keep the slot at size
+            g_options.read_size = size * g_options.direct_io_buffers;
+            return true;
+        case DIRECT_IO_MEMORY_IMPACT:
+            g_options.dma_block_size = size;
+            return true;
+        case MMAP:
+            g_options.mmap_chunk_size = size;
+            return true;
+        case SPLICE:
+            g_options.pipe_size = size;
+            return true;
+        default:
+            return false;
+    }
+}
+
+// Map a queue depth onto the engine's knob, direct_io's depth is its ring length
+static bool apply_queue_depth_knob(CopyMode mode, int depth) {
+    switch (mode) {
+        case IO_URING:
+        case LIBAIO:
+            g_options.queue_depth = depth;
+            return true;
+        case DIRECT_IO:
+            g_options.direct_io_buffers = depth;
+            return true;
+        default:
+            return false;
+    }
+}
+
+// Drop cached source pages so every cell reads from the device, not the previous cell's cache
+static void drop_source_cache(char **src_files, int num_files) {
+    for (int i = 0; i < num_files; i++) {
+        int fd = open(src_files[i], O_RDONLY);
+        if (fd >= 0) {
+            posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+            close(fd);
+        }
+    }
+}
+
+// Copy every source once with the current g_options, returns aggregate MiB/s or -1 on failure
+static double run_sweep_cell(CopyMode mode, char **src_files, int num_files, const char *to_dir) {
+    CopyTask *tasks = calloc(num_files, sizeof(CopyTask));
+
+    for (int i = 0; i < num_files; i++) {
+        tasks[i].src_path = src_files[i];
+        tasks[i].dst_path = malloc(strlen(to_dir) + strlen(src_files[i]) + 2);
+        sprintf(tasks[i].dst_path, "%s/%s", to_dir, basename(src_files[i]));
+        tasks[i].mode = mode;
+    }
+
+    drop_source_cache(src_files, num_files);
+    double total_duration = run_copy_tasks(tasks, num_files);
+
+    double total_mib = 0;
+    bool failed = false;
+    for (int i = 0; i < num_files; i++) {
+        total_mib += tasks[i].size_mib;
+        failed |= tasks[i].result != 0;
+        free(tasks[i].dst_path);
+    }
+    free(tasks);
+
+    return (failed || total_duration <= 0) ? -1 : total_mib / total_duration;
+}
+
+// Print one heatmap cell, colored relative to the best result when writing to a terminal
+static void print_sweep_cell(double speed, double best, bool color) {
+    if (speed < 0) {
+        printf(" %10s", "failed");
+        return;
+    }
+    if (!color) {
+        printf(" %10.2f", speed);
+        return;
+    }
+
+    const char *shade = speed >= best * 0.9 ? "\033[42;30m" :
+                        speed >= best * 0.6 ? "\033[43;30m" : "\033[41;37m";
+    printf(" %s%10.2f\033[0m", shade, speed);
+}
+
+// Handle sweep mode: run one engine over block size x thread count x queue depth
+static int handle_sweep(int argc, char *argv[]) {
+    char **src_files = malloc(sizeof(char *) * argc);
+    char *to_dir = NULL;
+    int num_files = 0;
+    const char *engine = NULL;
+    CopyMode mode = -1;
+    uint64_t block_sizes[MAX_SWEEP_VALUES] = { DEFAULT_IO_BLOCK_SIZE };
+    uint64_t thread_counts[MAX_SWEEP_VALUES] = { 1 };
+    uint64_t queue_depths[MAX_SWEEP_VALUES] = { DEFAULT_QUEUE_DEPTH };
+    int num_blocks = 1, num_threads = 1, num_depths = 1;
+
+    for (int i = 3; i < argc; i++) {
+        if (strcmp(argv[i], "--from") == 0) {
+            while (i + 1 < argc && strncmp(argv[i + 1], "--", 2) != 0) {
+                src_files[num_files++] = argv[++i];
+            }
+        } else if (strcmp(argv[i], "--to") == 0 && i + 1 < argc) {
+            to_dir = argv[++i];
+        } else if (strcmp(argv[i], "--engine") == 0 && i + 1 < argc) {
+            engine = argv[++i];
+            mode = parse_copy_mode(engine);
+        } else if (strcmp(argv[i], "--block-sizes") == 0 && i + 1 < argc) {
+            num_blocks = parse_value_list(argv[++i], block_sizes, true);
+        } else if (strcmp(argv[i], "--threads-list") == 0 && i + 1 < argc) {
+            num_threads = parse_value_list(argv[++i], thread_counts, false);
+        } else if (strcmp(argv[i], "--queue-depths") == 0 && i + 1 < argc) {
+            num_depths = parse_value_list(argv[++i], queue_depths, false);
+        } else if (!parse_copy_option(argc, argv, &i)) {
+            printf("Unknown option: %s\n", argv[i]);
+            free(src_files);
+            return 1;
+        }
+    }
+
+    if (num_files == 0 || !to_dir || mode == (CopyMode)-1) {
+        printf("Sweep needs --engine, --from and --to\n");
+        free(src_files);
+        return 1;
+    }
+    if (num_blocks <= 0 || num_threads <= 0 || num_depths <= 0) {
+        printf("Sweep lists must hold 1 to %d positive values\n", MAX_SWEEP_VALUES);
+        free(src_files);
+        return 1;
+    }
+
+    // Axes the engine has no knob for collapse to a single column or table
+    CopyOptions base = g_options;
+    bool has_block_axis = apply_block_size_knob(mode, block_sizes[0]);
+    bool has_depth_axis = apply_queue_depth_knob(mode, queue_depths[0]);
+    g_options = base;
+
+    if (!has_block_axis && num_blocks > 1) {
+        printf("Note: %s has no block size knob, --block-sizes is ignored\n", engine);
+        num_blocks = 1;
+    }
+    if (!has_depth_axis && num_depths > 1) {
+        printf("Note: %s has no queue depth knob, --queue-depths is ignored\n", engine);
+        num_depths = 1;
+    }
+    for (int t = 0; t < num_threads && !mode_supports_ranges(mode); t++) {
+        if (thread_counts[t] > (uint64_t)num_files) {
+            printf("Note: %s copies whole files, thread counts above %d still run %d worker%s\n",
+                   engine, num_files, num_files, num_files > 1 ? "s" : "");
+            break;
+        }
+    }
+
+    double *speeds = malloc(sizeof(double) * num_blocks * num_threads * num_depths);
+    double best = 0;
+    int best_cell = -1;
+
+    for (int d = 0; d < num_depths; d++) {
+        for (int b = 0; b < num_blocks; b++) {
+            for (int t = 0; t < num_threads; t++) {
+                int cell = (d * num_blocks + b) * num_threads + t;
+
+                // Depth first: direct_io sizes its read budget from the buffer count
+                g_options = base;
+                g_options.threads = thread_counts[t];
+                // Threads beyond the file count only help if the files are split
+                int chunks = (thread_counts[t] + num_files - 1) / num_files;
+                if (chunks > g_options.chunks_per_file) {
+                    g_options.chunks_per_file = chunks;
+                }
+                apply_queue_depth_knob(mode, queue_depths[d]);
+                apply_block_size_knob(mode, block_sizes[b]);
+
+                if (!validate_copy_options()) {
+                    speeds[cell] = -1;
+                    continue;
+                }
+
+                speeds[cell] = run_sweep_cell(mode, src_files, num_files, to_dir);
+                if (speeds[cell] > best) {
+                    best = speeds[cell];
+                    best_cell = cell;
+                }
+            }
+        }
+    }
+    g_options = base;
+
+    // One table per queue depth: rows are block sizes, columns are thread counts, cells are MiB/s
+    bool color = isatty(STDOUT_FILENO);
+    char label[32];
+
+    printf("\nSweep Results (%s, MiB/s):\n", engine);
+    for (int d = 0; d < num_depths; d++) {
+        if (has_depth_axis) {
+            printf("\nQueue Depth %llu\n", (unsigned long long)queue_depths[d]);
+        }
+
+        printf("%-10s", "Block");
+        for (int t = 0; t < num_threads; t++) {
+            snprintf(label, sizeof(label), "%llut", (unsigned long long)thread_counts[t]);
+            printf(" %10s", label);
+        }
+        printf("\n");
+
+        for (int b = 0; b < num_blocks; b++) {
+            format_size(block_sizes[b], label, sizeof(label));
+            printf("%-10s", has_block_axis ? label : "-");
+            for (int t = 0; t < num_threads; t++) {
+                print_sweep_cell(speeds[(d * num_blocks + b) * num_threads + t], best, color);
+            }
+            printf("\n");
+        }
+    }
+
+    if (best_cell >= 0) {
+        int t = best_cell % num_threads;
+        int b = (best_cell / num_threads) % num_blocks;
+        int d = best_cell / (num_threads * num_blocks);
+        format_size(block_sizes[b], label, sizeof(label));
+        printf("\nBest: %.2f MiB/s with %llu threads", best, (unsigned long long)thread_counts[t]);
+        if (has_block_axis) {
+            printf(", block size %s", label);
+        }
+        if (has_depth_axis) {
+            printf(", queue depth %llu", (unsigned long long)queue_depths[d]);
+        }
+        printf("\n");
+    }
+
+    free(speeds);
+    free(src_files);
+    return best_cell >= 0 ? 0 : 1;
+}
+
+// Threads that run memory kernels in lockstep. Each round opens at the start barrier
+// and closes at the done barrier, so its time covers the slowest thread, as in STREAM.
+typedef struct MemoryGang MemoryGang;
+typedef void (*GangFunction)(MemoryGang *gang, int id);
+
+struct MemoryGang {
+    int num_threads;
+    pthread_t *threads;
+    pthread_barrier_t start;
+    pthread_barrier_t done;
+    int *pin_cpus;          // --pin order, thread i runs on pin_cpus[i % num_pin_cpus]
+    int num_pin_cpus;
+    int node;               // Node threads and their buffers are placed on, -1 if none
+    GangFunction setup;     // Allocates and first-touches the thread's buffers
+    GangFunction round;     // Runs the current kernel on the thread's share
+    void *ctx;
+    bool stopping;
+};
+
+typedef struct {
+    MemoryGang *gang;
+    int id;
+} GangThread;
+
+static void *memory_gang_thread(void *arg) {
+    GangThread *thread = (GangThread *)arg;
+    MemoryGang *gang = thread->gang;
+    int id = thread->id;
+    free(thread);
+
+    cpu_set_t cpus;
+    if (gang->num_pin_cpus > 0) {
+        CPU_ZERO(&cpus);
+        CPU_SET(gang->pin_cpus[id % gang->num_pin_cpus], &cpus);
+        pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+    } else if (g_options.has_cpus) {
+        pthread_setaffinity_np(pthread_self(), sizeof(g_options.cpus), &g_options.cpus);
+    }
+    numa_place_thread(gang->node);
+
+    gang->setup(gang, id);
+    pthread_barrier_wait(&gang->done);
+    for (;;) {
+        pthread_barrier_wait(&gang->start);
+        if (gang->stopping) {
+            break;
+        }
+        gang->round(gang, id);
+        pthread_barrier_wait(&gang->done);
+    }
+    return NULL;
+}
+
+// Start num_threads placed threads and wait until all of them have run setup
+static void memory_gang_start(MemoryGang *gang, int num_threads, int node,
+                              GangFunction setup, GangFunction round, void *ctx) {
+    gang->num_threads = num_threads;
+    gang->threads = malloc(sizeof(pthread_t) * num_threads);
+    gang->num_pin_cpus = build_pin_order(&gang->pin_cpus);
+    gang->node = node;
+    gang->setup = setup;
+    gang->round = round;
+    gang->ctx = ctx;
+    gang->stopping = false;
+    pthread_barrier_init(&gang->start, NULL, num_threads + 1);
+    pthread_barrier_init(&gang->done, NULL, num_threads + 1);
+
+    for (int i = 0; i < num_threads; i++) {
+        GangThread *thread = malloc(sizeof(GangThread));
+        thread->gang = gang;
+        thread->id = i;
+        pthread_create(&gang->threads[i], NULL, memory_gang_thread, thread);
+    }
+    pthread_barrier_wait(&gang->done);
+}
+
+// Run one round on every thread, returns its wall-clock time in seconds
+static double memory_gang_round(MemoryGang *gang) {
+    pthread_barrier_wait(&gang->start);
+    uint64_t start = monotonic_ns();
+    pthread_barrier_wait(&gang->done);
+    return (monotonic_ns() - start) / 1e9;
+}
+
+static void memory_gang_stop(MemoryGang *gang) {
+    gang->stopping = true;
+    pthread_barrier_wait(&gang->start);
+    for (int i = 0; i < gang->num_threads; i++) {
+        pthread_join(gang->threads[i], NULL);
+    }
+    pthread_barrier_destroy(&gang->start);
+    pthread_barrier_destroy(&gang->done);
+    free(gang->threads);
+    free(gang->pin_cpus);
+}
+
+// STREAM kernels (McCalpin) plus read-only and write-only passes. The plain Write pass
+// pays for a read-for-ownership of every line it stores to, the non-temporal one does
+// not, so the two separate write bandwidth from the write-allocate reads
+typedef enum {
+    STREAM_COPY,   // c = a
+    STREAM_SCALE,  // b = s * c
+    STREAM_ADD,    // c = a + b
+    STREAM_TRIAD,  // a = b + s * c
+    STREAM_READ,   // sum of a
+    STREAM_WRITE,  // a = s
+    STREAM_WRITE_NT,  // a = s with non-temporal stores
+    NUM_STREAM_KERNELS
+} StreamKernel;
+
+static const struct {
+    const char *name;
+    int arrays;  // Arrays moved per element, STREAM counts bytes this way
+} stream_kernels[NUM_STREAM_KERNELS] = {
+    {"Copy", 2}, {"Scale", 2}, {"Add", 3}, {"Triad", 3}, {"Read", 1}, {"Write", 1}, {"WriteNT", 1},
+};
+
+#define STREAM_SCALAR 3.0
+#define DEFAULT_STREAM_ARRAY_SIZE (256 * 1024 * 1024)  // Per array, well past most LLCs
+#define DEFAULT_STREAM_REPEAT 5
+#define STREAM_SATURATION 0.95  // Share of the peak that counts as saturated
+
+typedef struct {
+    size_t elements;     // Per thread and array
+    double **a, **b, **c;
+    StreamKernel kernel;
+    bool failed;
+    volatile double sink;  // Keeps the read kernel's sum alive
+} StreamState;
+
+static void stream_setup(MemoryGang *gang, int id) {
+    StreamState *state = (StreamState *)gang->ctx;
+    size_t bytes = state->elements * sizeof(double);
+    void *buffer = NULL;
+
+    // One borrow per thread from the thread itself, so its pages are local to it
+    if (alloc_io_buffer(&buffer, 64, 3 * bytes) != 0) {
+        state->failed = true;
+        state->a[id] = state->b[id] = state->c[id] = NULL;
+        return;
+    }
+    state->a[id] = (double *)buffer;
+    state->b[id] = (double *)((char *)buffer + bytes);
+    state->c[id] = (double *)((char *)buffer + 2 * bytes);
+    for (size_t i = 0; i < state->elements; i++) {
+        state->a[id][i] = 1.0;
+        state->b[id][i] = 2.0;
+        state->c[id][i] = 0.0;
+    }
+}
+
+static double stream_read(const double *restrict a, size_t n) {
+    // Independent partial sums, one chain would be bound by add latency, not memory
+    double sum[8] = {0};
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        for (int k = 0; k < 8; k++) {
+            sum[k] += a[i + k];
+        }
     }
-    
-    // Cleanup
-    free(buf);
-    if (fsync(fd) < 0) {
-        perror("fsync");
-        close(fd);
-        return -1;
+    for (; i < n; i++) {
+        sum[0] += a[i];
     }
-    close(fd);
+    return sum[0] + sum[1] + sum[2] + sum[3] + sum[4] + sum[5] + sum[6] + sum[7];
+}
+
+// Plain stores where the CPU has no streaming store
+static void stream_write_nt(double *a, size_t n) {
+    size_t i = 0;
+#if defined(__x86_64__)
+    __m128d v = _mm_set1_pd(STREAM_SCALAR);
+    for (; i + 2 <= n; i += 2) {
+        _mm_stream_pd(a + i, v);
+    }
+    _mm_sfence();
+#endif
+    for (; i < n; i++) {
+        a[i] = STREAM_SCALAR;
+    }
+}
+
+static void stream_round(MemoryGang *gang, int id) {
+    StreamState *state = (StreamState *)gang->ctx;
+    double *restrict a = state->a[id];
+    double *restrict b = state->b[id];
+    double *restrict c = state->c[id];
+    size_t n = state->elements;
+    if (!a) {
+        return;
+    }
+
+    switch (state->kernel) {
+        case STREAM_COPY:
+            for (size_t i = 0; i < n; i++) c[i] = a[i];
+            break;
+        case STREAM_SCALE:
+            for (size_t i = 0; i < n; i++) b[i] = STREAM_SCALAR * c[i];
+            break;
+        case STREAM_ADD:
+            for (size_t i = 0; i < n; i++) c[i] = a[i] + b[i];
+            break;
+        case STREAM_TRIAD:
+            for (size_t i = 0; i < n; i++) a[i] = b[i] + STREAM_SCALAR * c[i];
+            break;
+        case STREAM_READ:
+            state->sink = stream_read(a, n);
+            break;
+        case STREAM_WRITE:
+            for (size_t i = 0; i < n; i++) a[i] = STREAM_SCALAR;
+            break;
+        case STREAM_WRITE_NT:
+            stream_write_nt(a, n);
+            break;
+        default:
+            break;
+    }
+}
+
+// Best MiB/s of every kernel over repeat rounds with num_threads threads.
+// The arrays are split evenly between the threads. Returns false on allocation failure.
+static bool run_stream_kernels(int num_threads, size_t array_size, int repeat, double *speeds) {
+    StreamState state = {0};
+    state.elements = array_size / sizeof(double) / num_threads;
+    state.a = calloc(num_threads, sizeof(double *));
+    state.b = calloc(num_threads, sizeof(double *));
+    state.c = calloc(num_threads, sizeof(double *));
+
+    MemoryGang gang;
+    int node = (g_options.numa == NUMA_NODE) ? g_options.numa_node : -1;
+    memory_gang_start(&gang, num_threads, node, stream_setup, stream_round, &state);
+
+    double best[NUM_STREAM_KERNELS];
+    for (int k = 0; k < NUM_STREAM_KERNELS; k++) {
+        best[k] = INFINITY;
+    }
+    for (int r = 0; r < repeat && !state.failed; r++) {
+        for (int k = 0; k < NUM_STREAM_KERNELS; k++) {
+            state.kernel = k;
+            best[k] = fmin(best[k], memory_gang_round(&gang));
+        }
+    }
+    memory_gang_stop(&gang);
+
+    double moved = (double)state.elements * sizeof(double) * num_threads / (1024.0 * 1024.0);
+    for (int k = 0; k < NUM_STREAM_KERNELS; k++) {
+        speeds[k] = moved * stream_kernels[k].arrays / best[k];
+    }
+
+    for (int i = 0; i < num_threads; i++) {
+        free_io_buffer(state.a[i]);
+    }
+    free(state.a);
+    free(state.b);
+    free(state.c);
+    buffer_pool_drain();
+    return !state.failed;
+}
+
+// Handle memory_bandwidth mode: STREAM kernels over a range of thread counts
+static int handle_memory_bandwidth(int argc, char *argv[]) {
+    uint64_t array_size = DEFAULT_STREAM_ARRAY_SIZE;
+    uint64_t thread_counts[MAX_SWEEP_VALUES];
+    int num_counts = 0;
+    int repeat = DEFAULT_STREAM_REPEAT;
+
+    for (int i = 3; i < argc; i++) {
+        if (strcmp(argv[i], "--size") == 0 && i + 1 < argc) {
+            array_size = parse_size(argv[++i]);
+        } else if (strcmp(argv[i], "--threads-list") == 0 && i + 1 < argc) {
+            num_counts = parse_value_list(argv[++i], thread_counts, false);
+        } else if (strcmp(argv[i], "--repeat") == 0 && i + 1 < argc) {
+            repeat = atoi(argv[++i]);
+        } else if (!parse_copy_option(argc, argv, &i)) {
+            printf("Unknown option: %s\n", argv[i]);
+            return 1;
+        }
+    }
+
+    if (!validate_copy_options()) {
+        return 1;
+    }
+    if (num_counts < 0 || repeat <= 0) {
+        printf("Thread list must hold 1 to %d positive values, repeat must be positive\n", MAX_SWEEP_VALUES);
+        return 1;
+    }
+    if (num_counts == 0) {
+        // Doubling up to every allowed CPU
+        cpu_set_t cpus;
+        allowed_cpus(&cpus);
+        int max_threads = CPU_COUNT(&cpus) > 0 ? CPU_COUNT(&cpus) : 1;
+        for (int t = 1; t < max_threads && num_counts < MAX_SWEEP_VALUES - 1; t *= 2) {
+            thread_counts[num_counts++] = t;
+        }
+        thread_counts[num_counts++] = max_threads;
+    }
+    if (array_size / sizeof(double) < thread_counts[num_counts - 1]) {
+        printf("Array size is too small for %llu threads\n", (unsigned long long)thread_counts[num_counts - 1]);
+        return 1;
+    }
+
+    char label[32];
+    format_size(array_size, label, sizeof(label));
+    printf("Memory Bandwidth (MiB/s, best of %d, %s per array):\n", repeat, label);
+    printf("%-10s", "Threads");
+    for (int k = 0; k < NUM_STREAM_KERNELS; k++) {
+        printf(" %12s", stream_kernels[k].name);
+    }
+    printf("\n");
+
+    double (*speeds)[NUM_STREAM_KERNELS] = calloc(num_counts, sizeof(*speeds));
+    for (int t = 0; t < num_counts; t++) {
+        printf("%-10llu", (unsigned long long)thread_counts[t]);
+        fflush(stdout);
+        if (!run_stream_kernels(thread_counts[t], array_size, repeat, speeds[t])) {
+            printf(" failed to allocate the arrays\n");
+            free(speeds);
+            return 1;
+        }
+        for (int k = 0; k < NUM_STREAM_KERNELS; k++) {
+            printf(" %12.2f", speeds[t][k]);
+        }
+        printf("\n");
+    }
+
+    // Saturation curve: the thread count each kernel peaks at, and the first that comes close
+    printf("\nSaturation:\n");
+    int copy_peak = 0;
+    for (int k = 0; k < NUM_STREAM_KERNELS; k++) {
+        int peak = 0, knee = -1;
+        for (int t = 1; t < num_counts; t++) {
+            if (speeds[t][k] > speeds[peak][k]) {
+                peak = t;
+            }
+        }
+        for (int t = 0; t < num_counts && knee < 0; t++) {
+            if (speeds[t][k] >= speeds[peak][k] * STREAM_SATURATION) {
+                knee = t;
+            }
+        }
+        if (k == STREAM_COPY) {
+            copy_peak = peak;
+        }
+        printf("%-10s peak %.2f MiB/s at %llu threads, %.0f%% of it from %llu threads\n",
+               stream_kernels[k].name, speeds[peak][k], (unsigned long long)thread_counts[peak],
+               STREAM_SATURATION * 100, (unsigned long long)thread_counts[knee]);
+    }
+
+    // A copy reads and writes the same bytes. Plain stores also read each line in
+    // (write-allocate), which the Write pass already includes; streaming stores do not.
+    double read = speeds[copy_peak][STREAM_READ];
+    double write = speeds[copy_peak][STREAM_WRITE];
+    double write_nt = speeds[copy_peak][STREAM_WRITE_NT];
+    double copy = speeds[copy_peak][STREAM_COPY];
+    double allocate = 2.0 / (1.0 / read + 1.0 / write);
+    double streaming = 2.0 / (1.0 / read + 1.0 / write_nt);
+    printf("\nCopy at %llu threads: %.2f MiB/s, %.2f expected with write-allocate, "
+           "%.2f with non-temporal stores\n",
+           (unsigned long long)thread_counts[copy_peak], copy, allocate, streaming);
+    if (streaming > allocate && fabs(copy - allocate) < fabs(copy - streaming)) {
+        printf("Copies pay for write-allocate reads, non-temporal stores would avoid them\n");
+    } else {
+        double store = (streaming > allocate) ? write_nt : write;
+        printf("Copies are %s-bandwidth bound\n", read < store ? "read" : "write");
+    }
+
+    free(speeds);
     return 0;
 }
 
-// Thread function for generating test files
+// memcpy_bench: every copy kernel over transfer sizes and source/destination misalignments
+#define MEMCPY_BENCH_TARGET_BYTES (128 * 1024 * 1024)  // Bytes copied per timed batch
+#define MEMCPY_BENCH_BATCHES 3                         // Best batch is reported
+
+// TSC ticks per nanosecond, 0 where there is no usable cycle counter
+static double calibrate_cycle_counter(void) {
+#if defined(__x86_64__)
+    uint64_t start_ns = monotonic_ns();
+    uint64_t start_ticks = __rdtsc();
+    while (monotonic_ns() - start_ns < 20 * 1000 * 1000) {
+    }
+    return (double)(__rdtsc() - start_ticks) / (monotonic_ns() - start_ns);
+#else
+    return 0;
+#endif
+}
+
+// Seconds per copy of size bytes, best of the batches
+static double time_copy_kernel(CopyFunction fn, char *dst, const char *src, size_t size) {
+    size_t iterations = MEMCPY_BENCH_TARGET_BYTES / size;
+    if (iterations == 0) {
+        iterations = 1;
+    }
+
+    double best = INFINITY;
+    for (int batch = 0; batch < MEMCPY_BENCH_BATCHES; batch++) {
+        uint64_t start = monotonic_ns();
+        for (size_t i = 0; i < iterations; i++) {
+            fn(dst, src, size);
+            // Keep the compiler from treating repeated copies as one
+            __asm__ volatile("" : : "r"(dst) : "memory");
+        }
+        best = fmin(best, (monotonic_ns() - start) / 1e9 / iterations);
+    }
+    return best;
+}
+
+// Handle memcpy_bench mode
+static int handle_memcpy_bench(int argc, char *argv[]) {
+    uint64_t sizes[MAX_SWEEP_VALUES] = {
+        64, 256, 1024, 4096, 16 << 10, 64 << 10, 256 << 10, 1 << 20, 4 << 20, 16 << 20, 64 << 20,
+        256 << 20, 1 << 30,
+    };
+    uint64_t offsets[MAX_SWEEP_VALUES] = {0, 1};
+    int num_sizes = 13, num_offsets = 2;
+
+    for (int i = 3; i < argc; i++) {
+        if (strcmp(argv[i], "--sizes") == 0 && i + 1 < argc) {
+            num_sizes = parse_value_list(argv[++i], sizes, true);
+        } else if (strcmp(argv[i], "--offsets") == 0 && i + 1 < argc) {
+            // 0 is a valid offset, so this list is parsed here rather than by parse_value_list
+            num_offsets = 0;
+            char *copy = strdup(argv[++i]);
+            char *save = NULL;
+            for (char *token = strtok_r(copy, ",", &save); token; token = strtok_r(NULL, ",", &save)) {
+                int offset = atoi(token);
+                if (num_offsets == MAX_SWEEP_VALUES || offset < 0 || offset >= 4096) {
+                    num_offsets = -1;
+                    break;
+                }
+                offsets[num_offsets++] = offset;
+            }
+            free(copy);
+        } else if (!parse_copy_option(argc, argv, &i)) {
+            printf("Unknown option: %s\n", argv[i]);
+            return 1;
+        }
+    }
+
+    if (!validate_copy_options()) {
+        return 1;
+    }
+    if (num_sizes <= 0 || num_offsets <= 0) {
+        printf("Size lists must hold 1 to %d positive values, offsets 0 to 4095\n", MAX_SWEEP_VALUES);
+        return 1;
+    }
+
+    // Single-threaded: run where --pin would put the first worker, or within --cpus
+    int *pin_cpus = NULL;
+    if (build_pin_order(&pin_cpus) > 0) {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(pin_cpus[0], &cpus);
+        sched_setaffinity(0, sizeof(cpus), &cpus);
+    } else if (g_options.has_cpus) {
+        sched_setaffinity(0, sizeof(g_options.cpus), &g_options.cpus);
+    }
+    free(pin_cpus);
+
+    CopyKernel kernels[NUM_COPY_KERNELS];
+    int num_kernels = 0;
+    for (int k = COPY_KERNEL_AUTO + 1; k < NUM_COPY_KERNELS; k++) {
+        if (copy_kernel_available(k)) {
+            kernels[num_kernels++] = k;
+        }
+    }
+
+    uint64_t max_size = 0;
+    for (int s = 0; s < num_sizes; s++) {
+        max_size = (sizes[s] > max_size) ? sizes[s] : max_size;
+    }
+    // Offsets are applied within one page past a page-aligned start
+    void *buffer = NULL;
+    size_t span = align_up(max_size, 4096) + 4096;
+    if (alloc_io_buffer(&buffer, 4096, 2 * span) != 0) {
+        printf("Failed to allocate %llu bytes\n", (unsigned long long)(2 * span));
+        return 1;
+    }
+    char *src_base = (char *)buffer;
+    char *dst_base = (char *)buffer + span;
+    memset(src_base, 0x5a, span);
+
+    double ticks_per_ns = calibrate_cycle_counter();
+    char label[32];
+
+    printf("memcpy Kernels (GB/s and %s per byte, best of %d batches):\n",
+           ticks_per_ns > 0 ? "TSC cycles" : "ns", MEMCPY_BENCH_BATCHES);
+    for (int so = 0; so < num_offsets; so++) {
+        for (int d = 0; d < num_offsets; d++) {
+            printf("\nSource offset %llu, destination offset %llu\n",
+                   (unsigned long long)offsets[so], (unsigned long long)offsets[d]);
+            printf("%-8s", "Size");
+            for (int k = 0; k < num_kernels; k++) {
+                printf(" %16s", copy_kernels[kernels[k]].name);
+            }
+            printf("  %s\n", "Best");
+
+            for (int s = 0; s < num_sizes; s++) {
+                format_size(sizes[s], label, sizeof(label));
+                printf("%-8s", label);
+                fflush(stdout);
+
+                int best = 0;
+                double best_seconds = INFINITY;
+                for (int k = 0; k < num_kernels; k++) {
+                    double seconds = time_copy_kernel(copy_kernels[kernels[k]].fn, dst_base + offsets[d],
+                                                      src_base + offsets[so], sizes[s]);
+                    double per_byte = seconds * 1e9 / sizes[s] * (ticks_per_ns > 0 ? ticks_per_ns : 1);
+                    printf(" %8.2f %7.3f", sizes[s] / seconds / 1e9, per_byte);
+                    if (seconds < best_seconds) {
+                        best_seconds = seconds;
+                        best = k;
+                    }
+                }
+                printf("  %s\n", copy_kernels[kernels[best]].name);
+            }
+        }
+    }
+
+    free_io_buffer(buffer);
+    buffer_pool_drain();
+    return 0;
+}
+
+// cache_sweep: copy bandwidth and load latency for working sets from L1 to past the LLC
+#define CACHE_SWEEP_MAX_SIZES 32
+#define CACHE_SWEEP_MIN_SIZE 4096
+#define CACHE_SWEEP_LLC_MULTIPLE 4                    // Largest default set, times the LLC
+#define CACHE_SWEEP_LOADS (2 * 1024 * 1024)           // Dependent loads per latency round
+#define CACHE_SWEEP_COPY_BYTES (64 * 1024 * 1024)     // Bytes each thread copies per round
+#define CACHE_LINE 64
+
+// Data/unified cache sizes of the CPU this thread runs on, by level (index 1..4)
+static void read_cache_sizes(size_t sizes[5]) {
+    memset(sizes, 0, sizeof(size_t) * 5);
+    int cpu = sched_getcpu();
+    for (int index = 0; index < 16; index++) {
+        char path[128], value[64];
+        int level = 0;
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/cache/index%d/level", cpu < 0 ? 0 : cpu, index);
+        FILE *file = fopen(path, "r");
+        if (!file) {
+            break;
+        }
+        if (fscanf(file, "%d", &level) != 1) level = 0;
+        fclose(file);
+
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/cache/index%d/type", cpu < 0 ? 0 : cpu, index);
+        file = fopen(path, "r");
+        if (!file) continue;
+        bool instruction = fgets(value, sizeof(value), file) && strncmp(value, "Instruction", 11) == 0;
+        fclose(file);
+
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/cache/index%d/size", cpu < 0 ? 0 : cpu, index);
+        file = fopen(path, "r");
+        if (!file) continue;
+        if (!instruction && level >= 1 && level <= 4 && fscanf(file, "%63s", value) == 1) {
+            sizes[level] = parse_size(value);
+        }
+        fclose(file);
+    }
+}
+
+typedef enum {
+    CACHE_CHAIN,  // Link the thread's share into a random cycle of cache lines, untimed
+    CACHE_CHASE,  // Follow the cycle, every load depends on the previous one
+    CACHE_COPY    // Copy the first half of the share onto the second half
+} CachePhase;
+
 typedef struct {
-    char *path;
-    uint64_t size;
-    int index;
-    double duration;
-} GenerateTask;
+    char **buffers;      // One per thread, max_share bytes
+    size_t share;        // Bytes of the working set each thread touches this round
+    CachePhase phase;
+    size_t loads;        // Per thread for CACHE_CHASE
+    size_t copies;       // Per thread for CACHE_COPY
+    CopyFunction copy;
+    size_t max_share;
+    bool failed;
+    volatile uintptr_t sink;
+} CacheSweepState;
 
-void* generate_file_thread(void *arg) {
-    GenerateTask *task = (GenerateTask *)arg;
-    struct timeval start, end;
-    
-    gettimeofday(&start, NULL);
-    int result = generate_test_file(task->path, task->size);
-    gettimeofday(&end, NULL);
-    
-    task->duration = (end.tv_sec - start.tv_sec) + 
-                    (end.tv_usec - start.tv_usec) / 1000000.0;
-    
-    return (void*)(long)result;
+static void cache_sweep_setup(MemoryGang *gang, int id) {
+    CacheSweepState *state = (CacheSweepState *)gang->ctx;
+    void *buffer = NULL;
+    if (alloc_io_buffer(&buffer, 4096, state->max_share) != 0) {
+        state->failed = true;
+    }
+    state->buffers[id] = buffer;
 }
 
-// New function: handle generate test files mode
-static int handle_generate_test_files(int argc, char *argv[]) {
-    if (argc < 7) {
-        printf("Missing parameters for generate_test_files mode\n");
+static void cache_sweep_round(MemoryGang *gang, int id) {
+    CacheSweepState *state = (CacheSweepState *)gang->ctx;
+    char *buffer = state->buffers[id];
+    if (!buffer) {
+        return;
+    }
+
+    size_t lines = state->share / CACHE_LINE;
+    switch (state->phase) {
+        case CACHE_CHAIN: {
+            // Random order defeats the hardware prefetchers
+            size_t *order = malloc(sizeof(size_t) * lines);
+            RandomGenerator gen;
+            init_random_generator(&gen);
+            gen.seed += id;
+            for (size_t i = 0; i < lines; i++) {
+                order[i] = i;
+            }
+            for (size_t i = lines - 1; i > 0; i--) {
+                gen.seed = gen.seed * gen.multiplier + gen.increment;
+                size_t j = (gen.seed >> 33) % (i + 1);
+                size_t swap = order[i];
+                order[i] = order[j];
+                order[j] = swap;
+            }
+            for (size_t i = 0; i < lines; i++) {
+                *(void **)(buffer + order[i] * CACHE_LINE) = buffer + order[(i + 1) % lines] * CACHE_LINE;
+            }
+            free(order);
+            break;
+        }
+        case CACHE_CHASE: {
+            void *p = buffer;
+            for (size_t i = 0; i < state->loads; i++) {
+                p = *(void **)p;
+            }
+            state->sink = (uintptr_t)p;
+            break;
+        }
+        case CACHE_COPY: {
+            size_t half = state->share / 2;
+            for (size_t i = 0; i < state->copies; i++) {
+                state->copy(buffer + half, buffer, half);
+                __asm__ volatile("" : : "r"(buffer) : "memory");
+            }
+            break;
+        }
+    }
+}
+
+// Copy GB/s and ns per load for each working set, split evenly over num_threads threads.
+// Sets too small to give every thread a page are marked with NAN.
+static bool run_cache_sweep(int num_threads, const uint64_t *sizes, int num_sizes,
+                            double *bandwidth, double *latency) {
+    CacheSweepState state = {0};
+    state.buffers = calloc(num_threads, sizeof(char *));
+    state.copy = (g_options.copy_kernel == COPY_KERNEL_AUTO) ? copy_libc :
+                 copy_kernels[g_options.copy_kernel].fn;
+    for (int s = 0; s < num_sizes; s++) {
+        size_t share = align_up(sizes[s] / num_threads, CACHE_LINE);
+        state.max_share = (share > state.max_share) ? share : state.max_share;
+    }
+
+    MemoryGang gang;
+    int node = (g_options.numa == NUMA_NODE) ? g_options.numa_node : -1;
+    memory_gang_start(&gang, num_threads, node, cache_sweep_setup, cache_sweep_round, &state);
+
+    for (int s = 0; s < num_sizes && !state.failed; s++) {
+        state.share = sizes[s] / num_threads / CACHE_LINE * CACHE_LINE;
+        if (state.share < CACHE_SWEEP_MIN_SIZE) {
+            bandwidth[s] = latency[s] = NAN;
+            continue;
+        }
+
+        state.phase = CACHE_CHAIN;
+        memory_gang_round(&gang);
+        state.phase = CACHE_CHASE;
+        state.loads = CACHE_SWEEP_LOADS;
+        memory_gang_round(&gang);  // Warm up: bring the set into the cache it fits in
+        latency[s] = memory_gang_round(&gang) * 1e9 / state.loads;
+
+        state.phase = CACHE_COPY;
+        state.copies = CACHE_SWEEP_COPY_BYTES / (state.share / 2);
+        state.copies = state.copies ? state.copies : 1;
+        memory_gang_round(&gang);
+        double seconds = memory_gang_round(&gang);
+        bandwidth[s] = (double)state.copies * (state.share / 2) * num_threads / seconds / 1e9;
+    }
+    memory_gang_stop(&gang);
+
+    for (int i = 0; i < num_threads; i++) {
+        free_io_buffer(state.buffers[i]);
+    }
+    free(state.buffers);
+    buffer_pool_drain();
+    return !state.failed;
+}
+
+// Handle cache_sweep mode
+static int handle_cache_sweep(int argc, char *argv[]) {
+    uint64_t sizes[CACHE_SWEEP_MAX_SIZES];
+    int num_sizes = 0;
+
+    for (int i = 3; i < argc; i++) {
+        if (strcmp(argv[i], "--sizes") == 0 && i + 1 < argc) {
+            num_sizes = parse_value_list(argv[++i], sizes, true);
+            if (num_sizes <= 0) {
+                printf("Size list must hold 1 to %d positive values\n", MAX_SWEEP_VALUES);
+                return 1;
+            }
+        } else if (!parse_copy_option(argc, argv, &i)) {
+            printf("Unknown option: %s\n", argv[i]);
+            return 1;
+        }
+    }
+
+    if (!validate_copy_options()) {
         return 1;
     }
-    
-    uint64_t file_size = 0;
-    int num_files = 0;
-    char *output_dir = ".";  // Default to current directory
-    
-    // Parse arguments
-    for (int i = 3; i < argc; i += 2) {
-        if (strcmp(argv[i], "--size") == 0) {
-            file_size = parse_size(argv[i+1]);
-        } else if (strcmp(argv[i], "--num") == 0) {
-            num_files = atoi(argv[i+1]);
-        } else if (strcmp(argv[i], "--dir") == 0) {
-            output_dir = argv[i+1];
+    for (int s = 0; s < num_sizes; s++) {
+        if (sizes[s] < CACHE_SWEEP_MIN_SIZE) {
+            printf("Working sets must be at least one page (%dK)\n", CACHE_SWEEP_MIN_SIZE / 1024);
+            return 1;
         }
     }
-    
-    if (file_size == 0 || num_files <= 0) {
-        printf("Invalid size or number of files\n");
+
+    size_t caches[5];
+    read_cache_sizes(caches);
+    size_t llc = 0;
+    for (int level = 1; level <= 4; level++) {
+        llc = caches[level] ? caches[level] : llc;
+    }
+    if (num_sizes == 0) {
+        // Doubling from one page to a few times the LLC
+        uint64_t limit = llc ? (uint64_t)llc * CACHE_SWEEP_LLC_MULTIPLE : 256 * 1024 * 1024;
+        for (uint64_t size = CACHE_SWEEP_MIN_SIZE; num_sizes < CACHE_SWEEP_MAX_SIZES; size *= 2) {
+            sizes[num_sizes++] = size;
+            if (size >= limit) {
+                break;
+            }
+        }
+    }
+
+    cpu_set_t cpus;
+    allowed_cpus(&cpus);
+    int all_threads = g_options.threads > 0 ? g_options.threads : (CPU_COUNT(&cpus) > 0 ? CPU_COUNT(&cpus) : 1);
+
+    double *single_bw = calloc(num_sizes, sizeof(double));
+    double *single_lat = calloc(num_sizes, sizeof(double));
+    double *all_bw = calloc(num_sizes, sizeof(double));
+    double *all_lat = calloc(num_sizes, sizeof(double));
+    bool ok = run_cache_sweep(1, sizes, num_sizes, single_bw, single_lat) &&
+              (all_threads == 1 || run_cache_sweep(all_threads, sizes, num_sizes, all_bw, all_lat));
+
+    char label[32];
+    printf("Caches:");
+    for (int level = 1; level <= 4; level++) {
+        if (caches[level]) {
+            format_size(caches[level], label, sizeof(label));
+            printf(" L%d %s", level, label);
+        }
+    }
+    printf("\n\nCache Sweep (copy GB/s, load latency ns; all-thread sets are split over %d threads):\n",
+           all_threads);
+    printf("%-10s %-6s %14s %14s", "Set", "Level", "1t Copy", "1t Latency");
+    if (all_threads > 1) {
+        printf(" %14s %14s", "All Copy", "All Latency");
+    }
+    printf("\n");
+
+    for (int s = 0; s < num_sizes && ok; s++) {
+        // The first level the whole set fits in, for a single thread
+        char level[8] = "DRAM";
+        for (int l = 1; l <= 4; l++) {
+            if (caches[l] && sizes[s] <= caches[l]) {
+                snprintf(level, sizeof(level), "L%d", l);
+                break;
+            }
+        }
+        format_size(sizes[s], label, sizeof(label));
+        printf("%-10s %-6s %14.2f %14.2f", label, level, single_bw[s], single_lat[s]);
+        if (all_threads > 1) {
+            if (isnan(all_bw[s])) {
+                printf(" %14s %14s", "-", "-");
+            } else {
+                printf(" %14.2f %14.2f", all_bw[s], all_lat[s]);
+            }
+        }
+        printf("\n");
+    }
+    if (!ok) {
+        printf("Failed to allocate the working sets\n");
+    } else if (g_options.huge_pages == HUGE_PAGES_NONE) {
+        // Past the L1 dTLB reach the random chase also misses the TLB on most loads
+        printf("\nNote: the working sets use 4K pages, so latency at L2 sizes and beyond includes\n"
+               "dTLB misses and page walks; rerun with --huge-pages 2M to measure the caches alone\n");
+    } else {
+        const char *names[] = {"none", "THP", "2M", "1G"};
+        printf("\nWorking sets use %s huge pages", names[g_options.huge_pages]);
+        if (atomic_load(&g_huge_page_fallbacks) > 0) {
+            printf(" (some fell back to THP, reserve more in /sys/kernel/mm/hugepages)");
+        }
+        printf(",\nTLB misses only remain past the huge-page TLB reach\n");
+    }
+
+    free(single_bw);
+    free(single_lat);
+    free(all_bw);
+    free(all_lat);
+    return ok ? 0 : 1;
+}
+
+// numa_matrix: the direct_io_memory_impact kernel for every combination of the node
+// the threads run on and the nodes the source and destination buffers live on
+#define DEFAULT_NUMA_MATRIX_REPEAT 3
+
+typedef struct {
+    int src_node;
+    int dst_node;
+    size_t size;          // Bytes per buffer and per pass, for every thread
+    char **src, **dst;
+    bool failed;
+    volatile uint64_t sink;
+} NumaMatrixState;
+
+// Borrow a buffer whose pages prefer node, whatever node the caller is placed on
+static int alloc_node_buffer(void **buffer, size_t size, int node) {
+    int placed = t_numa_node;
+    t_numa_node = node;
+    int ret = alloc_io_buffer(buffer, sysconf(_SC_PAGESIZE), size);
+    t_numa_node = placed;
+    return ret;
+}
+
+static void numa_matrix_setup(MemoryGang *gang, int id) {
+    NumaMatrixState *state = (NumaMatrixState *)gang->ctx;
+    void *src = NULL, *dst = NULL;
+
+    if (alloc_node_buffer(&src, state->size, state->src_node) != 0 ||
+        alloc_node_buffer(&dst, state->size, state->dst_node) != 0) {
+        state->failed = true;
+    } else {
+        RandomGenerator gen;
+        init_random_generator(&gen);
+        fill_buffer_with_random_data(&gen, src, state->size);
+    }
+    state->src[id] = src;
+    state->dst[id] = dst;
+}
+
+static void numa_matrix_round(MemoryGang *gang, int id) {
+    NumaMatrixState *state = (NumaMatrixState *)gang->ctx;
+    if (state->src[id] && state->dst[id]) {
+        state->sink = simulate_dma_copy(state->src[id], state->dst[id], state->size, state->size);
+    }
+}
+
+// MiB/s of num_threads threads on cpu_node copying from src_node to dst_node memory, -1 on failure
+static double run_numa_matrix_cell(int cpu_node, int src_node, int dst_node, int num_threads,
+                                   size_t size, int repeat) {
+    NumaMatrixState state = {0};
+    state.src_node = src_node;
+    state.dst_node = dst_node;
+    state.size = size;
+    state.src = calloc(num_threads, sizeof(char *));
+    state.dst = calloc(num_threads, sizeof(char *));
+
+    MemoryGang gang;
+    memory_gang_start(&gang, num_threads, cpu_node, numa_matrix_setup, numa_matrix_round, &state);
+    double best = INFINITY;
+    for (int r = 0; r < repeat && !state.failed; r++) {
+        best = fmin(best, memory_gang_round(&gang));
+    }
+    memory_gang_stop(&gang);
+
+    for (int i = 0; i < num_threads; i++) {
+        free_io_buffer(state.src[i]);
+        free_io_buffer(state.dst[i]);
+    }
+    free(state.src);
+    free(state.dst);
+    buffer_pool_drain();
+    return state.failed ? -1 : (double)size * num_threads / (1024.0 * 1024.0) / best;
+}
+
+// Handle numa_matrix mode
+static int handle_numa_matrix(int argc, char *argv[]) {
+    uint64_t size = DEFAULT_STREAM_ARRAY_SIZE;
+    int repeat = DEFAULT_NUMA_MATRIX_REPEAT;
+
+    for (int i = 3; i < argc; i++) {
+        if (strcmp(argv[i], "--size") == 0 && i + 1 < argc) {
+            size = parse_size(argv[++i]);
+        } else if (strcmp(argv[i], "--repeat") == 0 && i + 1 < argc) {
+            repeat = atoi(argv[++i]);
+        } else if (!parse_copy_option(argc, argv, &i)) {
+            printf("Unknown option: %s\n", argv[i]);
+            return 1;
+        }
+    }
+
+    if (!validate_copy_options()) {
+        return 1;
+    }
+    if (size == 0 || size % sysconf(_SC_PAGESIZE) != 0 || repeat <= 0) {
+        printf("Size must be a multiple of the page size and repeat must be positive\n");
         return 1;
     }
-    
-    // Create and execute generation tasks
-    GenerateTask *tasks = malloc(sizeof(GenerateTask) * num_files);
-    pthread_t *threads = malloc(sizeof(pthread_t) * num_files);
-    
-    printf("Generating %d test files of size %luB each in %s\n", 
-           num_files, file_size, output_dir);
-    
-    for (int i = 0; i < num_files; i++) {
-        tasks[i].path = malloc(strlen(output_dir) + 32);
-        sprintf(tasks[i].path, "%s/test_file_%d", output_dir, i + 1);
-        tasks[i].size = file_size;
-        tasks[i].index = i;
-        
-        pthread_create(&threads[i], NULL, generate_file_thread, &tasks[i]);
+    if (g_options.pin != PIN_NONE || g_options.numa != NUMA_NONE) {
+        printf("Note: numa_matrix places threads and buffers itself, --pin and --numa are ignored\n");
+        g_options.pin = PIN_NONE;
+        g_options.numa = NUMA_NONE;
     }
-    
-    // Wait for all threads to complete
-    bool all_success = true;
-    for (int i = 0; i < num_files; i++) {
-        void *thread_result;
-        pthread_join(threads[i], &thread_result);
-        if ((long)thread_result != 0) {
-            all_success = false;
+
+    // Online nodes use the same list format as CPUs
+    cpu_set_t online;
+    char list[1024] = "0";
+    FILE *fp = fopen("/sys/devices/system/node/online", "r");
+    if (fp) {
+        if (!fgets(list, sizeof(list), fp)) {
+            strcpy(list, "0");
         }
+        fclose(fp);
     }
-    
-    // Print results
-    printf("\nGeneration Results:\n");
-    printf("%-10s %-30s %-15s %-12s\n", 
-           "File #", "Path", "Size", "Duration (s)");
-    printf("------------------------------------------------------------\n");
-    
-    double total_duration = 0;
-    for (int i = 0; i < num_files; i++) {
-        printf("%-10d %-30s %-15lu %11.2f\n",
-               i + 1, tasks[i].path, file_size, tasks[i].duration);
-        total_duration = (tasks[i].duration > total_duration) ? 
-                        tasks[i].duration : total_duration;
+    int nodes[NUMA_MAX_NODES];
+    int num_nodes = 0;
+    if (parse_cpu_list(list, &online)) {
+        for (int node = 0; node < CPU_SETSIZE && node < NUMA_MAX_NODES; node++) {
+            if (CPU_ISSET(node, &online)) {
+                nodes[num_nodes++] = node;
+            }
+        }
     }
-    
-    printf("\nTotal Statistics:\n");
-    printf("Total Size: %.2f GiB\n", 
-           (file_size * num_files) / (1024.0 * 1024.0 * 1024.0));
-    printf("Total Duration: %.2f seconds\n", total_duration);
-    printf("Average Speed: %.2f MiB/s\n", 
-           (file_size * num_files) / (1024.0 * 1024.0) / total_duration);
-    
-    // Cleanup resources
-    for (int i = 0; i < num_files; i++) {
-        free(tasks[i].path);
+    if (num_nodes == 0) {
+        nodes[num_nodes++] = 0;
     }
-    free(tasks);
-    free(threads);
-    
-    return all_success ? 0 : 1;
+
+    int num_threads = g_options.threads > 0 ? g_options.threads : 1;
+    char label[32];
+    format_size(size, label, sizeof(label));
+    printf("NUMA Bandwidth Matrix (MiB/s, %d thread%s, %s per buffer, dma block %zu KiB, best of %d):\n",
+           num_threads, num_threads == 1 ? "" : "s", label, g_options.dma_block_size / 1024, repeat);
+
+    double best = 0, worst = INFINITY;
+    for (int c = 0; c < num_nodes; c++) {
+        cpu_set_t cpus;
+        if (!numa_node_cpus(nodes[c], &cpus) || CPU_COUNT(&cpus) == 0) {
+            continue;  // Memory-only node, nothing can run there
+        }
+
+        printf("\nThreads on node %d (rows: source memory, columns: destination memory)\n", nodes[c]);
+        printf("%-8s", "Src\\Dst");
+        for (int d = 0; d < num_nodes; d++) {
+            snprintf(label, sizeof(label), "node%d", nodes[d]);
+            printf(" %12s", label);
+        }
+        printf("\n");
+
+        for (int s = 0; s < num_nodes; s++) {
+            snprintf(label, sizeof(label), "node%d", nodes[s]);
+            printf("%-8s", label);
+            fflush(stdout);
+            for (int d = 0; d < num_nodes; d++) {
+                double speed = run_numa_matrix_cell(nodes[c], nodes[s], nodes[d], num_threads, size, repeat);
+                if (speed < 0) {
+                    printf(" %12s", "failed");
+                    continue;
+                }
+                printf(" %12.2f", speed);
+                fflush(stdout);
+                best = fmax(best, speed);
+                worst = fmin(worst, speed);
+            }
+            printf("\n");
+        }
+    }
+
+    if (best > 0) {
+        printf("\nBest %.2f MiB/s, worst %.2f MiB/s (%.2fx): an unpinned memory result can land anywhere in between\n",
+               best, worst, best / worst);
+    }
+    return best > 0 ? 0 : 1;
 }
 
-// Add benchmark result structure
+// contention: disk copies and the memory-impact kernel, first alone and then at the same
+// time, to see whether storage DMA and CPU copies compete for the memory channels
+#define CONTENTION_MIN_SECONDS 1.0
+#define CONTENTION_SLOWDOWN 0.10  // Slowdown that counts as interference, over noise
+
+// Memory-impact rounds run back to back by a coordinator thread until stopped
 typedef struct {
-    char *filename;
-    double size_mib;
-    double memory_duration;
-    double memory_speed;
-    double disk_duration;
-    double disk_speed;
-} BenchmarkResult;
+    MemoryGang *gang;
+    atomic_bool stop;
+    uint64_t rounds;
+    double seconds;
+} MemoryLoad;
 
-// New function to handle benchmark mode
-static int handle_benchmark(int argc, char *argv[]) {
-    uint64_t file_size = 0;
-    int num_files = 0;
-    char *from_dir = NULL;
+static void *memory_load_thread(void *arg) {
+    MemoryLoad *load = (MemoryLoad *)arg;
+    while (!atomic_load(&load->stop)) {
+        load->seconds += memory_gang_round(load->gang);
+        load->rounds++;
+    }
+    return NULL;
+}
+
+static void memory_load_start(MemoryLoad *load, MemoryGang *gang, pthread_t *thread) {
+    load->gang = gang;
+    atomic_init(&load->stop, false);
+    load->rounds = 0;
+    load->seconds = 0;
+    pthread_create(thread, NULL, memory_load_thread, load);
+}
+
+// Stop the load and return its MiB/s
+static double memory_load_stop(MemoryLoad *load, pthread_t thread, size_t size) {
+    atomic_store(&load->stop, true);
+    pthread_join(thread, NULL);
+    if (load->rounds == 0 || load->seconds <= 0) {
+        return 0;
+    }
+    return (double)load->rounds * size * load->gang->num_threads / (1024.0 * 1024.0) / load->seconds;
+}
+
+// Handle contention mode
+static int handle_contention(int argc, char *argv[]) {
+    char **src_files = malloc(sizeof(char *) * argc);
     char *to_dir = NULL;
-    
-    // Parse arguments
-    for (int i = 3; i < argc; i += 2) {
-        if (strcmp(argv[i], "--size") == 0) {
-            file_size = parse_size(argv[i+1]);
-        } else if (strcmp(argv[i], "--num") == 0) {
-            num_files = atoi(argv[i+1]);
-        } else if (strcmp(argv[i], "--from") == 0) {
-            from_dir = argv[i+1];
-        } else if (strcmp(argv[i], "--to") == 0) {
-            to_dir = argv[i+1];
+    int num_files = 0;
+    CopyMode mode = DIRECT_IO;
+    const char *engine = "direct_io";
+    uint64_t size = DEFAULT_STREAM_ARRAY_SIZE;
+    int memory_threads = 1;
+
+    for (int i = 3; i < argc; i++) {
+        if (strcmp(argv[i], "--from") == 0) {
+            while (i + 1 < argc && strncmp(argv[i + 1], "--", 2) != 0) {
+                src_files[num_files++] = argv[++i];
+            }
+        } else if (strcmp(argv[i], "--to") == 0 && i + 1 < argc) {
+            to_dir = argv[++i];
+        } else if (strcmp(argv[i], "--engine") == 0 && i + 1 < argc) {
+            engine = argv[++i];
+            mode = parse_copy_mode(engine);
+        } else if (strcmp(argv[i], "--size") == 0 && i + 1 < argc) {
+            size = parse_size(argv[++i]);
+        } else if (strcmp(argv[i], "--memory-threads") == 0 && i + 1 < argc) {
+            memory_threads = atoi(argv[++i]);
+        } else if (!parse_copy_option(argc, argv, &i)) {
+            printf("Unknown option: %s\n", argv[i]);
+            free(src_files);
+            return 1;
         }
     }
-    
-    if (file_size == 0 || num_files <= 0 || !from_dir || !to_dir) {
-        printf("Invalid parameters for benchmark mode\n");
+
+    if (num_files == 0 || !to_dir || mode == (CopyMode)-1 || mode == DIRECT_IO_MEMORY_IMPACT) {
+        printf("Contention needs a disk --engine (default direct_io), --from and --to\n");
+        free(src_files);
         return 1;
     }
-
-    // Generate test files first
-    printf("Generating test files...\n");
-    GenerateTask *gen_tasks = malloc(sizeof(GenerateTask) * num_files);
-    pthread_t *gen_threads = malloc(sizeof(pthread_t) * num_files);
-    
-    for (int i = 0; i < num_files; i++) {
-        gen_tasks[i].path = malloc(strlen(from_dir) + 32);
-        sprintf(gen_tasks[i].path, "%s/test_file_%d", from_dir, i + 1);
-        gen_tasks[i].size = file_size;
-        gen_tasks[i].index = i;
-        pthread_create(&gen_threads[i], NULL, generate_file_thread, &gen_tasks[i]);
+    if (size == 0 || size % sysconf(_SC_PAGESIZE) != 0 || memory_threads <= 0) {
+        printf("Size must be a multiple of the page size and memory threads must be positive\n");
+        free(src_files);
+        return 1;
     }
-    
-    for (int i = 0; i < num_files; i++) {
-        pthread_join(gen_threads[i], NULL);
+    if (!validate_copy_options()) {
+        free(src_files);
+        return 1;
     }
 
-    // Prepare benchmark results array
-    BenchmarkResult *results = malloc(sizeof(BenchmarkResult) * num_files);
-    
-    // Run memory impact tests using existing function
-    printf("\nRunning memory copy tests...\n");
-    for (int i = 0; i < num_files; i++) {
-        CopyTask task;
-        task.src_path = gen_tasks[i].path;
-        task.dst_path = malloc(strlen(to_dir) + 32);
-        sprintf(task.dst_path, "%s/test_file_%d", to_dir, i + 1);
-        task.mode = DIRECT_IO_MEMORY_IMPACT;
+    // Memory threads float (within --cpus) rather than take the copy workers' --pin slots
+    int node = (g_options.numa == NUMA_NODE) ? g_options.numa_node : -1;
+    NumaMatrixState state = {0};
+    state.src_node = state.dst_node = node;
+    state.size = size;
+    state.src = calloc(memory_threads, sizeof(char *));
+    state.dst = calloc(memory_threads, sizeof(char *));
+    PinPolicy pin = g_options.pin;
+    g_options.pin = PIN_NONE;
+    MemoryGang gang;
+    memory_gang_start(&gang, memory_threads, node, numa_matrix_setup, numa_matrix_round, &state);
+    g_options.pin = pin;
 
-        copy_file_thread(&task);
+    double disk_alone = -1, disk_together = -1, memory_alone = 0, memory_together = 0;
+    if (!state.failed) {
+        printf("Copying with %s alone...\n", engine);
+        uint64_t start = monotonic_ns();
+        disk_alone = run_sweep_cell(mode, src_files, num_files, to_dir);
+        double disk_seconds = (monotonic_ns() - start) / 1e9;
 
-        results[i].filename = strdup(basename(task.src_path));
-        results[i].size_mib = task.size_mib;
-        results[i].memory_duration = task.duration;
-        results[i].memory_speed = task.speed;
+        // As long as the disk copy took, so both see the same thermal and background state
+        printf("Running the memory-impact kernel alone...\n");
+        MemoryLoad load;
+        pthread_t load_thread;
+        memory_load_start(&load, &gang, &load_thread);
+        usleep((useconds_t)(fmax(disk_seconds, CONTENTION_MIN_SECONDS) * 1e6));
+        memory_alone = memory_load_stop(&load, load_thread, size);
 
-        free(task.dst_path);
+        printf("Running both together...\n");
+        memory_load_start(&load, &gang, &load_thread);
+        disk_together = run_sweep_cell(mode, src_files, num_files, to_dir);
+        memory_together = memory_load_stop(&load, load_thread, size);
     }
+    memory_gang_stop(&gang);
 
-    // Run disk copy tests using direct_io mode
-    printf("\nRunning disk copy tests...\n");
-    for (int i = 0; i < num_files; i++) {
-        CopyTask task;
-        task.src_path = gen_tasks[i].path;
-        task.dst_path = malloc(strlen(to_dir) + 32);
-        sprintf(task.dst_path, "%s/test_file_%d_disk", to_dir, i + 1);
-        task.mode = DIRECT_IO;
+    for (int i = 0; i < memory_threads; i++) {
+        free_io_buffer(state.src[i]);
+        free_io_buffer(state.dst[i]);
+    }
+    free(state.src);
+    free(state.dst);
+    buffer_pool_drain();
+    free(src_files);
+
+    if (state.failed || disk_alone <= 0 || disk_together <= 0 || memory_alone <= 0) {
+        printf("Contention run failed\n");
+        return 1;
+    }
 
-        copy_file_thread(&task);
+    double disk_slowdown = 1.0 - disk_together / disk_alone;
+    double memory_slowdown = 1.0 - memory_together / memory_alone;
+    char label[48];
 
-        results[i].disk_duration = task.duration;
-        results[i].disk_speed = task.speed;
+    printf("\nContention Results:\n");
+    printf("%-28s %16s %16s %10s\n", "Workload", "Alone (MiB/s)", "Together (MiB/s)", "Slowdown");
+    printf("--------------------------------------------------------------------------\n");
+    printf("%-28s %16.2f %16.2f %9.1f%%\n", engine, disk_alone, disk_together, disk_slowdown * 100);
+    snprintf(label, sizeof(label), "memory impact (%d thread%s)", memory_threads, memory_threads == 1 ? "" : "s");
+    printf("%-28s %16.2f %16.2f %9.1f%%\n", label, memory_alone, memory_together, memory_slowdown * 100);
+    printf("Combined: %.2f MiB/s of disk plus memory traffic together\n", disk_together + memory_together);
 
-        free(task.dst_path);
+    // Oversubscribed CPUs slow both sides down without any memory traffic involved
+    cpu_set_t cpus;
+    allowed_cpus(&cpus);
+    int copy_workers = resolve_worker_count(num_files * g_options.chunks_per_file);
+    bool oversubscribed = CPU_COUNT(&cpus) < copy_workers + memory_threads;
+    if (oversubscribed) {
+        printf("Note: %d copy workers and %d memory threads share %d CPUs, the slowdown includes CPU time sharing\n",
+               copy_workers, memory_threads, CPU_COUNT(&cpus));
     }
+    if (oversubscribed && (disk_slowdown > CONTENTION_SLOWDOWN || memory_slowdown > CONTENTION_SLOWDOWN)) {
+        printf("Slowdown not attributable: CPUs oversubscribed, lower --threads or --memory-threads\n");
+    } else if (disk_slowdown > CONTENTION_SLOWDOWN && memory_slowdown > CONTENTION_SLOWDOWN) {
+        printf("\033[41m\033[37mStorage DMA and CPU copies compete for memory bandwidth\033[0m\n");
+    } else if (disk_slowdown > CONTENTION_SLOWDOWN) {
+        printf("The disk copy slows down under memory load\n");
+    } else if (memory_slowdown > CONTENTION_SLOWDOWN) {
+        printf("The memory-impact kernel slows down under the disk copy\n");
+    } else {
+        printf("No interference above %.0f%%\n", CONTENTION_SLOWDOWN * 100);
+    }
+    return 0;
+}
 
-    // Calculate total statistics
-    double total_size = 0, total_memory_duration = 0, total_disk_duration = 0;
-    for (int i = 0; i < num_files; i++) {
-        total_size += results[i].size_mib;
-        total_memory_duration = fmax(total_memory_duration, results[i].memory_duration);
-        total_disk_duration = fmax(total_disk_duration, results[i].disk_duration);
+// Autotune search space, a step doubles or halves one parameter
+#define AUTOTUNE_MAX_TRIALS 24
+#define AUTOTUNE_MIN_GAIN 1.03  // A step must beat the best by 3% to count over noise
+#define AUTOTUNE_MIN_BLOCK (64 * 1024)
+#define AUTOTUNE_MAX_BLOCK (64 * 1024 * 1024)
+
+typedef struct {
+    int threads;
+    uint64_t block_size;
+    int queue_depth;
+} TuneConfig;
+
+static bool tune_config_equal(const TuneConfig *a, const TuneConfig *b) {
+    return a->threads == b->threads && a->block_size == b->block_size && a->queue_depth == b->queue_depth;
+}
+
+typedef struct {
+    CopyMode mode;
+    char **src_files;
+    int num_files;
+    const char *to_dir;
+    CopyOptions base;
+    bool has_block_axis;
+    bool has_depth_axis;
+    uint64_t max_pipe_size;  // splice's block axis is capped by pipe-max-size
+    int trials;
+    TuneConfig tried[AUTOTUNE_MAX_TRIALS];
+    double tried_speed[AUTOTUNE_MAX_TRIALS];
+} Autotuner;
+
+// Set g_options for one configuration. Threads beyond the file count only help if
+// the files are split, so chunks_per_file grows with them.
+static void apply_tune_config(const Autotuner *tuner, const TuneConfig *config) {
+    g_options = tuner->base;
+    g_options.threads = config->threads;
+    int chunks = (config->threads + tuner->num_files - 1) / tuner->num_files;
+    if (chunks > g_options.chunks_per_file) {
+        g_options.chunks_per_file = chunks;
     }
-    double avg_memory_speed = total_size / total_memory_duration;
-    double avg_disk_speed = total_size / total_disk_duration;
+    apply_queue_depth_knob(tuner->mode, config->queue_depth);
+    apply_block_size_knob(tuner->mode, config->block_size);
+}
 
-    // Print results
-    printf("\nBenchmark Results:\n");
-    printf("%-10s %-20s %-12s %-20s %-20s %-20s %-20s\n",
-           "Thread ID", "Filename", "Size (MiB)",
-           "Memory Copy (s)", "Memory Speed (MiB/s)",
-           "Disk Copy (s)", "Disk Speed (MiB/s)");
-    printf("--------------------------------------------------------------------------------------------------------\n");
+// Keep a stepped configuration inside what the engines accept
+static void clamp_tune_config(const Autotuner *tuner, TuneConfig *config) {
+    int max_threads = 4 * sysconf(_SC_NPROCESSORS_ONLN);
+    int min_depth = (tuner->mode == DIRECT_IO) ? 2 : 1;
+    int max_depth = (tuner->mode == DIRECT_IO) ? 16 : 256;
 
-    for (int i = 0; i < num_files; i++) {
-        printf("%-10d %-20s %11.2f %19.2f %19.2f %19.2f %19.2f\n",
-               i, results[i].filename, results[i].size_mib,
-               results[i].memory_duration, results[i].memory_speed,
-               results[i].disk_duration, results[i].disk_speed);
+    if (config->threads < 1) config->threads = 1;
+    if (config->threads > max_threads) config->threads = max_threads;
+    if (config->queue_depth < min_depth) config->queue_depth = min_depth;
+    if (config->queue_depth > max_depth) config->queue_depth = max_depth;
+
+    // direct_io allocates block * depth per file, keep that within the --read-size budget
+    uint64_t max_block = (tuner->mode == DIRECT_IO) ? tuner->base.read_size / config->queue_depth :
+                         (tuner->mode == SPLICE) ? tuner->max_pipe_size : AUTOTUNE_MAX_BLOCK;
+    if (config->block_size < AUTOTUNE_MIN_BLOCK) config->block_size = AUTOTUNE_MIN_BLOCK;
+    if (config->block_size > max_block) config->block_size = max_block;
+}
+
+// Copy a sample window of every source into scratch files, returns MiB/s or -1.
+// Each trial uses a different window so cached pages from earlier trials are not reread.
+// Configurations already measured return their earlier result.
+static double run_autotune_trial(Autotuner *tuner, const TuneConfig *config) {
+    for (int i = 0; i < tuner->trials; i++) {
+        if (tune_config_equal(&tuner->tried[i], config)) {
+            return tuner->tried_speed[i];
+        }
     }
 
-    printf("\nTotal Statistics:\n");
-    printf("Total Size: %.2f MiB\n", total_size);
-    printf("Memory Copy - Total Duration: %.2f seconds, Average Speed: %.2f MiB/s\n",
-           total_memory_duration, avg_memory_speed);
-    printf("Disk Copy   - Total Duration: %.2f seconds, Average Speed: %.2f MiB/s\n",
-           total_disk_duration, avg_disk_speed);
+    apply_tune_config(tuner, config);
+    if (!validate_copy_options()) {
+        return -1;
+    }
 
-    double speed_ratio = avg_disk_speed / avg_memory_speed;
-    if (speed_ratio >= 0.95) {
-        printf("\033[41m\033[37mYou may hit the memory bandwidth wall\033[0m\n");
+    uint64_t per_file = align_up(g_options.autotune_sample / tuner->num_files, g_options.align);
+    CopyTask *tasks = calloc(tuner->num_files, sizeof(CopyTask));
+
+    for (int i = 0; i < tuner->num_files; i++) {
+        const char *name = basename(tuner->src_files[i]);
+        tasks[i].src_path = tuner->src_files[i];
+        tasks[i].dst_path = malloc(strlen(tuner->to_dir) + strlen(name) + 12);
+        sprintf(tasks[i].dst_path, "%s/.autotune.%s", tuner->to_dir, name);
+        tasks[i].mode = tuner->mode;
+
+        struct stat st;
+        if (stat(tasks[i].src_path, &st) == 0 && (uint64_t)st.st_size > per_file) {
+            uint64_t windows = st.st_size / per_file;
+            tasks[i].sample_offset = (tuner->trials % windows) * per_file;
+            tasks[i].sample_size = per_file;
+        }
     }
 
-    // Cleanup
-    for (int i = 0; i < num_files; i++) {
-        free(gen_tasks[i].path);
-        free(results[i].filename);
+    drop_source_cache(tuner->src_files, tuner->num_files);
+    double duration = run_copy_tasks(tasks, tuner->num_files);
+
+    double total_mib = 0;
+    bool failed = false;
+    for (int i = 0; i < tuner->num_files; i++) {
+        total_mib += tasks[i].size_mib;
+        failed |= tasks[i].result != 0;
+        unlink(tasks[i].dst_path);
+        free(tasks[i].dst_path);
     }
-    free(gen_tasks);
-    free(gen_threads);
-    free(results);
+    free(tasks);
 
-    return 0;
-}
+    double speed = (failed || duration <= 0) ? -1 : total_mib / duration;
+    tuner->tried[tuner->trials] = *config;
+    tuner->tried_speed[tuner->trials] = speed;
+    tuner->trials++;
 
-// Print usage information
-static void print_usage(const char *program_name) {
-    printf("Usage:\n");
-    printf("  Copy files:\n");
-    printf("    %s --mode [cp|mmap|direct_io|direct_io_memory_impact] --from file1 [file2 ...] --to dest_dir\n", program_name);
-    printf("  Generate test files:\n");
-    printf("    %s --mode generate_test_files --size <size>[M|G|T] --num <number> [--dir <output_dir>]\n", program_name);
-    printf("  Benchmark:\n");
-    printf("    %s --mode benchmark --size <size>[M|G|T] --num <number> --from <source_dir> --to <dest_dir>\n", program_name);
+    char block[32];
+    format_size(config->block_size, block, sizeof(block));
+    printf("Autotune trial %2d: threads %-3d", tuner->trials, config->threads);
+    if (tuner->has_block_axis) {
+        printf(" block %-6s", block);
+    }
+    if (tuner->has_depth_axis) {
+        printf(" depth %-4d", config->queue_depth);
+    }
+    if (speed < 0) {
+        printf(" failed\n");
+    } else {
+        printf(" %10.2f MiB/s\n", speed);
+    }
+    return speed;
 }
 
-// Parse copy mode from command line argument
-static CopyMode parse_copy_mode(const char *mode_str) {
-    if (strcmp(mode_str, "cp") == 0) return SYSTEM_CP;
-    if (strcmp(mode_str, "mmap") == 0) return MMAP;
-    if (strcmp(mode_str, "direct_io") == 0) return DIRECT_IO;
-    if (strcmp(mode_str, "direct_io_memory_impact") == 0) return DIRECT_IO_MEMORY_IMPACT;
-    return -1;
-}
+// Hill-climb from the command line configuration: walk each parameter up (x2) or down (/2)
+// while it keeps improving, and repeat over all parameters until nothing moves.
+// Leaves the best configuration in g_options.
+static void autotune_copy_options(CopyMode mode, char **src_files, int num_files, const char *to_dir) {
+    Autotuner tuner = {.mode = mode, .src_files = src_files, .num_files = num_files,
+                       .to_dir = to_dir, .base = g_options, .max_pipe_size = AUTOTUNE_MAX_BLOCK};
+    // Pipes past pipe-max-size need CAP_SYS_RESOURCE, stay below it
+    FILE *fp = fopen("/proc/sys/fs/pipe-max-size", "r");
+    unsigned long long pipe_max;
+    if (fp && fscanf(fp, "%llu", &pipe_max) == 1) {
+        tuner.max_pipe_size = pipe_max;
+    }
+    if (fp) {
+        fclose(fp);
+    }
+    tuner.has_block_axis = apply_block_size_knob(mode, g_options.block_size);
+    tuner.has_depth_axis = apply_queue_depth_knob(mode, g_options.queue_depth);
+    g_options = tuner.base;
 
-// Print copy results
-static void print_copy_results(CopyTask *tasks, int num_files) {
-    printf("\nDetailed Results:\n");
-    printf("%-10s %-30s %-12s %-12s %-12s\n", 
-           "Thread ID", "Filename", "Size (MiB)", "Duration (s)", "Speed (MiB/s)");
-    printf("--------------------------------------------------------------------------------\n");
+    // Start from what the user asked for, in the units each engine actually uses
+    TuneConfig best = {
+        .threads = resolve_worker_count(num_files * g_options.chunks_per_file),
+        .block_size = g_options.block_size,
+        .queue_depth = g_options.queue_depth,
+    };
+    if (mode == DIRECT_IO) {
+        best.queue_depth = g_options.direct_io_buffers;
+        best.block_size = g_options.read_size / g_options.direct_io_buffers;
+    } else if (mode == SPLICE) {
+        best.block_size = g_options.pipe_size;
+    }
+    clamp_tune_config(&tuner, &best);
 
-    double total_size = 0, total_duration = 0;
-    for (int i = 0; i < num_files; i++) {
-        printf("%-10d %-30s %11.2f %11.2f %11.2f\n", 
-               i, basename(tasks[i].src_path), 
-               tasks[i].size_mib, tasks[i].duration, tasks[i].speed);
-        total_size += tasks[i].size_mib;
-        total_duration = (tasks[i].duration > total_duration) ? 
-                        tasks[i].duration : total_duration;
+    char sample[32];
+    format_size(g_options.autotune_sample, sample, sizeof(sample));
+    printf("Autotune: up to %d trials of %s each\n", AUTOTUNE_MAX_TRIALS, sample);
+    double best_speed = run_autotune_trial(&tuner, &best);
+
+    bool improved = true;
+    while (improved && tuner.trials < AUTOTUNE_MAX_TRIALS) {
+        improved = false;
+        for (int param = 0; param < 3; param++) {
+            if ((param == 1 && !tuner.has_block_axis) || (param == 2 && !tuner.has_depth_axis)) {
+                continue;
+            }
+
+            // Try doubling first, only try halving if doubling did not help
+            for (int direction = 0; direction < 2; direction++) {
+                bool moved = false;
+                while (tuner.trials < AUTOTUNE_MAX_TRIALS) {
+                    TuneConfig candidate = best;
+                    if (param == 0) {
+                        candidate.threads = direction == 0 ? best.threads * 2 : best.threads / 2;
+                    } else if (param == 1) {
+                        candidate.block_size = direction == 0 ? best.block_size * 2 : best.block_size / 2;
+                    } else {
+                        candidate.queue_depth = direction == 0 ? best.queue_depth * 2 : best.queue_depth / 2;
+                    }
+                    clamp_tune_config(&tuner, &candidate);
+                    if (tune_config_equal(&candidate, &best)) {
+                        break;
+                    }
+
+                    double speed = run_autotune_trial(&tuner, &candidate);
+                    if (speed <= best_speed * AUTOTUNE_MIN_GAIN) {
+                        break;
+                    }
+                    best = candidate;
+                    best_speed = speed;
+                    moved = improved = true;
+                }
+                if (moved) {
+                    break;
+                }
+            }
+        }
     }
 
-    printf("\nTotal Statistics:\n");
-    printf("Total Size: %.2f MiB\n", total_size);
-    printf("Total Duration: %.2f seconds\n", total_duration);
-    printf("Average Speed: %.2f MiB/s\n", total_size / total_duration);
+    apply_tune_config(&tuner, &best);
+
+    char block[32];
+    format_size(best.block_size, block, sizeof(block));
+    printf("Autotune: using threads %d, chunks per file %d", g_options.threads, g_options.chunks_per_file);
+    if (tuner.has_block_axis) {
+        printf(", block %s", block);
+    }
+    if (tuner.has_depth_axis) {
+        printf(", depth %d", best.queue_depth);
+    }
+    printf(" (%.2f MiB/s after %d trials)\n", best_speed, tuner.trials);
 }
 
 // Handle file copy mode
 static int handle_copy_files(int argc, char *argv[], CopyMode mode) {
-    int num_files = (argc - 6);
-    CopyTask *tasks = malloc(sizeof(CopyTask) * num_files);
-    pthread_t *threads = malloc(sizeof(pthread_t) * num_files);
+    char **src_files = malloc(sizeof(char *) * argc);
+    char *to_dir = NULL;
+    int num_files = 0;
+
+    // Parse arguments, --from takes every value up to the next option
+    for (int i = 3; i < argc; i++) {
+        if (strcmp(argv[i], "--from") == 0) {
+            while (i + 1 < argc && strncmp(argv[i + 1], "--", 2) != 0) {
+                src_files[num_files++] = argv[++i];
+            }
+        } else if (strcmp(argv[i], "--to") == 0 && i + 1 < argc) {
+            to_dir = argv[++i];
+        } else if (!parse_copy_option(argc, argv, &i)) {
+            printf("Unknown option: %s\n", argv[i]);
+            free(src_files);
+            return 1;
+        }
+    }
+
+    if (num_files == 0 || !to_dir) {
+        printf("Missing --from or --to for copy mode\n");
+        free(src_files);
+        return 1;
+    }
+
+    if (!validate_copy_options()) {
+        free(src_files);
+        return 1;
+    }
+
+    if (g_options.chunks_per_file > 1 && !mode_supports_ranges(mode)) {
+        printf("Note: --chunks-per-file is ignored in this mode\n");
+    }
+    if (g_options.adaptive && !mode_supports_ranges(mode)) {
+        printf("Note: --adaptive only throttles range engines, it has no effect in this mode\n");
+    }
+
+    if (g_options.autotune) {
+        if (mode_supports_ranges(mode)) {
+            autotune_copy_options(mode, src_files, num_files, to_dir);
+        } else {
+            printf("Note: --autotune needs a range engine (direct_io, io_uring, libaio, copy_file_range, splice)\n");
+        }
+    }
+
+    CopyTask *tasks = calloc(num_files, sizeof(CopyTask));
 
-    // Start all copy threads
     for (int i = 0; i < num_files; i++) {
-        tasks[i].src_path = argv[i + 4];
-        tasks[i].dst_path = malloc(strlen(argv[argc-1]) + strlen(argv[i + 4]) + 2);
-        sprintf(tasks[i].dst_path, "%s/%s", argv[argc-1], basename(argv[i + 4]));
+        tasks[i].src_path = src_files[i];
+        tasks[i].dst_path = malloc(strlen(to_dir) + strlen(src_files[i]) + 2);
+        sprintf(tasks[i].dst_path, "%s/%s", to_dir, basename(src_files[i]));
         tasks[i].mode = mode;
-        
-        pthread_create(&threads[i], NULL, copy_file_thread, &tasks[i]);
     }
 
-    // Wait for completion
-    for (int i = 0; i < num_files; i++) {
-        pthread_join(threads[i], NULL);
+    // Sample progress only for the real copy, not the autotune trials
+    if (g_options.progress_interval > 0) {
+        if (mode == SYSTEM_CP) {
+            printf("Note: --progress cannot see inside system cp\n");
+        } else {
+            g_progress.total_bytes = 0;
+            struct stat st;
+            for (int i = 0; i < num_files; i++) {
+                if (stat(src_files[i], &st) == 0) {
+                    g_progress.total_bytes += st.st_size;
+                }
+            }
+            g_progress.log = NULL;
+            if (g_options.progress_log) {
+                g_progress.log = fopen(g_options.progress_log, "w");
+                if (!g_progress.log) {
+                    perror(g_options.progress_log);
+                    for (int i = 0; i < num_files; i++) {
+                        free(tasks[i].dst_path);
+                    }
+                    free(tasks);
+                    free(src_files);
+                    return 1;
+                }
+                fprintf(g_progress.log, "elapsed_s,bytes_done,mib_per_s,avg_mib_per_s,eta_s\n");
+            }
+            g_progress.enabled = true;
+        }
+    }
+
+    // Copy through the worker pool and wait for completion
+    double total_duration = run_copy_tasks(tasks, num_files);
+    g_progress.enabled = false;
+    if (g_progress.log) {
+        fclose(g_progress.log);
+        g_progress.log = NULL;
     }
 
     // Print results and cleanup
-    print_copy_results(tasks, num_files);
+    print_copy_results(tasks, num_files, total_duration);
 
     for (int i = 0; i < num_files; i++) {
         free(tasks[i].dst_path);
     }
     free(tasks);
-    free(threads);
+    free(src_files);
 
     return 0;
 }
@@ -681,6 +5525,36 @@ int main(int argc, char *argv[]) {
         return handle_benchmark(argc, argv);
     }
     
+    // Handle sweep mode
+    if (strcmp(argv[2], "sweep") == 0) {
+        return handle_sweep(argc, argv);
+    }
+
+    // Handle memory bandwidth mode
+    if (strcmp(argv[2], "memory_bandwidth") == 0) {
+        return handle_memory_bandwidth(argc, argv);
+    }
+
+    // Handle memcpy kernel benchmark mode
+    if (strcmp(argv[2], "memcpy_bench") == 0) {
+        return handle_memcpy_bench(argc, argv);
+    }
+
+    // Handle cache hierarchy sweep mode
+    if (strcmp(argv[2], "cache_sweep") == 0) {
+        return handle_cache_sweep(argc, argv);
+    }
+
+    // Handle NUMA bandwidth matrix mode
+    if (strcmp(argv[2], "numa_matrix") == 0) {
+        return handle_numa_matrix(argc, argv);
+    }
+
+    // Handle disk plus memory contention mode
+    if (strcmp(argv[2], "contention") == 0) {
+        return handle_contention(argc, argv);
+    }
+
     // Handle copy mode
     CopyMode mode = parse_copy_mode(argv[2]);
     if (mode == -1) {